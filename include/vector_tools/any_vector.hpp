@@ -0,0 +1,405 @@
+#ifndef ANY_VECTOR_HEADER
+#define ANY_VECTOR_HEADER
+
+#include "vector_tools.hpp"
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+
+namespace vector_tools
+{
+	///A table of bulk operations on arrays of a single element type.
+	///Every operation works on a whole range, so type-erased code pays
+	///one indirect call per batch rather than one per element.
+	struct element_ops
+	{
+		const std::type_info *type;
+		std::size_t size;
+		std::size_t align;
+		bool trivially_copyable;
+
+		///Value-initializes `count` elements in unconstructed storage.
+		///NULL if the type is not default constructible.
+		void(*construct_range)(void *first, std::size_t count);
+		///Copy-constructs `count` elements from `input` into unconstructed storage at `output`.
+		void(*copy_range)(void *output, const void *input, std::size_t count);
+		///Relocates `count` elements from `input` to unconstructed storage at `output`.
+		///The ranges may overlap if `output` is not after `input`.
+		void(*relocate_range)(void *output, void *input, std::size_t count);
+		///Destroys `count` elements, in reverse order.
+		void(*destroy_range)(void *first, std::size_t count);
+		///Writes -1, 0 or 1 to `out[i]` as `lhs[i]` is less than, equal to or greater than `rhs[i]`.
+		///NULL if the type has no `operator<`.
+		void(*compare_range)(const void *lhs, const void *rhs, std::size_t count, signed char *out);
+	};
+
+	namespace detail
+	{
+		template<typename T, typename = void_t<>>
+		struct is_less_comparable : std::false_type
+		{};
+
+		template<typename T>
+		struct is_less_comparable<T,
+			void_t<decltype(std::declval<const T&>() < std::declval<const T&>())>> : std::true_type
+		{};
+
+		template<typename T>
+		struct erased_ops
+		{
+			using alloc_type = std::allocator<T>;
+
+			static void construct_range(void *first, std::size_t count)
+			{
+				alloc_type alloc;
+				emplace_construct_count(static_cast<T*>(first), count, alloc);
+			}
+
+			static void copy_range(void *output, const void *input, std::size_t count)
+			{
+				copy_range(output, input, count, std::is_trivially_copyable<T>{});
+			}
+
+			static void copy_range(void *output, const void *input, std::size_t count, std::true_type)
+			{
+				if (count != 0)
+					std::memcpy(output, input, count * sizeof(T));
+			}
+
+			static void copy_range(void *output, const void *input, std::size_t count, std::false_type)
+			{
+				alloc_type alloc;
+				auto first = static_cast<const T*>(input);
+				copy_insert_range(static_cast<T*>(output), alloc, first, first + count);
+			}
+
+			static void relocate_range(void *output, void *input, std::size_t count)
+			{
+				alloc_type alloc;
+				auto first = static_cast<T*>(input);
+				vector_tools::relocate_range(static_cast<T*>(output), alloc, first, first + count);
+			}
+
+			static void destroy_range(void *first, std::size_t count)
+			{
+				auto begin = static_cast<T*>(first);
+				destructor_destroy_range(begin, begin + count);
+			}
+
+			static void compare_range(const void *lhs, const void *rhs, std::size_t count, signed char *out)
+			{
+				auto left = static_cast<const T*>(lhs);
+				auto right = static_cast<const T*>(rhs);
+				for (std::size_t ix = 0; ix < count; ++ix)
+					out[ix] = static_cast<signed char>((right[ix] < left[ix]) - (left[ix] < right[ix]));
+			}
+		};
+
+		template<typename T>
+		constexpr auto select_construct_range(std::true_type) { return &erased_ops<T>::construct_range; }
+		template<typename T>
+		constexpr auto select_construct_range(std::false_type) { return static_cast<void(*)(void*, std::size_t)>(nullptr); }
+
+		template<typename T>
+		constexpr auto select_compare_range(std::true_type) { return &erased_ops<T>::compare_range; }
+		template<typename T>
+		constexpr auto select_compare_range(std::false_type)
+		{
+			return static_cast<void(*)(const void*, const void*, std::size_t, signed char*)>(nullptr);
+		}
+	}
+
+	///Returns the bulk operation table for `T`.
+	///Calling this is what registers a type for use with `any_vector`;
+	///the table is a static object, so the returned reference is valid forever.
+	template<typename T>
+	const element_ops &element_ops_for()
+	{
+		static_assert(!std::is_reference<T>::value && !std::is_const<T>::value,
+			"Elements must be non-const object types.");
+		static_assert(alignof(T) <= alignof(std::max_align_t),
+			"Over-aligned types are not supported.");
+
+		static const element_ops ops =
+		{
+			&typeid(T), sizeof(T), alignof(T), std::is_trivially_copyable<T>::value,
+			detail::select_construct_range<T>(std::is_default_constructible<T>{}),
+			&detail::erased_ops<T>::copy_range,
+			&detail::erased_ops<T>::relocate_range,
+			&detail::erased_ops<T>::destroy_range,
+			detail::select_compare_range<T>(detail::is_less_comparable<T>{}),
+		};
+		return ops;
+	}
+}
+
+///A vector whose element type is only known at runtime.
+///The element type is described by a `vector_tools::element_ops` table,
+///and every operation dispatches through it once per range, never once per element.
+///Elements are accessed as raw memory; `data_as<T>` gives a typed view when the type is known.
+class any_vector
+{
+public:
+	using size_type = std::size_t;
+
+	explicit any_vector(const vector_tools::element_ops &ops) noexcept
+		: ops_(&ops), first_(nullptr), size_(0), capacity_(0) {}
+
+	any_vector(const any_vector &other)
+		: any_vector(*other.ops_)
+	{
+		reserve(other.size_);
+		ops_->copy_range(first_, other.first_, other.size_);
+		size_ = other.size_;
+	}
+
+	any_vector(any_vector &&other) noexcept
+		: ops_(other.ops_), first_(other.first_), size_(other.size_), capacity_(other.capacity_)
+	{
+		other.nullify();
+	}
+
+	~any_vector()
+	{
+		clear_and_destroy();
+	}
+
+	any_vector &operator=(const any_vector &other)
+	{
+		if (this == &other)
+			return *this;
+
+		any_vector temp(other);
+		swap(temp);
+		return *this;
+	}
+
+	any_vector &operator=(any_vector &&other) noexcept
+	{
+		if (this == &other)
+			return *this;
+
+		clear_and_destroy();
+		ops_ = other.ops_;
+		first_ = other.first_;
+		size_ = other.size_;
+		capacity_ = other.capacity_;
+		other.nullify();
+		return *this;
+	}
+
+	void swap(any_vector &other) noexcept
+	{
+		using std::swap;
+		swap(ops_, other.ops_);
+		swap(first_, other.first_);
+		swap(size_, other.size_);
+		swap(capacity_, other.capacity_);
+	}
+
+	const vector_tools::element_ops &ops() const noexcept { return *ops_; }
+	const std::type_info &type() const noexcept { return *ops_->type; }
+	size_type element_size() const noexcept { return ops_->size; }
+
+	bool empty() const noexcept { return size_ == 0; }
+	size_type size() const noexcept { return size_; }
+	size_type capacity() const noexcept { return capacity_; }
+
+	void *data() noexcept { return first_; }
+	const void *data() const noexcept { return first_; }
+
+	void *element(size_type ix) noexcept { return first_ + ix * ops_->size; }
+	const void *element(size_type ix) const noexcept { return first_ + ix * ops_->size; }
+
+	///Returns the storage as an array of `T`.
+	///Throws `std::bad_cast` if `T` is not the element type.
+	template<typename T>
+	T *data_as()
+	{
+		check_type<T>();
+		return reinterpret_cast<T*>(first_);
+	}
+
+	template<typename T>
+	const T *data_as() const
+	{
+		check_type<T>();
+		return reinterpret_cast<const T*>(first_);
+	}
+
+	void reserve(size_type new_cap)
+	{
+		if (capacity_ >= new_cap)
+			return;
+
+		reallocate_storage(new_cap);
+	}
+
+	void shrink_to_fit()
+	{
+		if (size_ == capacity_)
+			return;
+
+		reallocate_storage(size_);
+	}
+
+	void clear() noexcept
+	{
+		ops_->destroy_range(first_, size_);
+		size_ = 0;
+	}
+
+	///Grows by value-initialization, or shrinks by destroying elements from the end.
+	void resize(size_type new_size)
+	{
+		if (new_size < size_)
+		{
+			ops_->destroy_range(element(new_size), size_ - new_size);
+			size_ = new_size;
+			return;
+		}
+
+		if (!ops_->construct_range)
+			throw std::logic_error("any_vector: element type is not default constructible");
+
+		ensure_space(new_size - size_);
+		ops_->construct_range(element(size_), new_size - size_);
+		size_ = new_size;
+	}
+
+	///Copies `count` elements from `input`, which must be an array of the element type,
+	///onto the end of the vector.
+	void append_range(const void *input, size_type count)
+	{
+		ensure_space(count);
+		ops_->copy_range(element(size_), input, count);
+		size_ += count;
+	}
+
+	///Copies `count` elements of `other` starting at `pos` onto the end of the vector.
+	///Both vectors must have the same element type. `other` may be this vector.
+	void append_range(const any_vector &other, size_type pos, size_type count)
+	{
+		check_same_type(other);
+		other.check_range(pos, count);
+
+		//Growing would free the elements being copied if they are our own, so grow before finding them.
+		ensure_space(count);
+		ops_->copy_range(element(size_), other.element(pos), count);
+		size_ += count;
+	}
+
+	///Erases the elements in `[first, last)`, relocating the tail down in one call.
+	void erase(size_type first, size_type last)
+	{
+		if (first == last)
+			return;
+
+		ops_->destroy_range(element(first), last - first);
+		try
+		{
+			ops_->relocate_range(element(first), element(last), size_ - last);
+		}
+		catch (...)
+		{
+			//The relocation destroyed everything from `first` onwards.
+			size_ = first;
+			throw;
+		}
+		size_ -= last - first;
+	}
+
+	///Compares this vector element-wise against `other`, starting at `pos` in both.
+	///Writes `count` results to `out`, as `element_ops::compare_range` does.
+	///Both vectors must have the same element type, and at least `pos + count` elements.
+	void compare(const any_vector &other, size_type pos, size_type count, signed char *out) const
+	{
+		check_same_type(other);
+		check_range(pos, count);
+		other.check_range(pos, count);
+		if (!ops_->compare_range)
+			throw std::logic_error("any_vector: element type is not comparable");
+
+		ops_->compare_range(element(pos), other.element(pos), count, out);
+	}
+
+private:
+	const vector_tools::element_ops *ops_;
+	unsigned char *first_;
+	size_type size_;
+	size_type capacity_;
+
+	template<typename T>
+	void check_type() const
+	{
+		if (*ops_->type != typeid(T))
+			throw std::bad_cast();
+	}
+
+	void check_same_type(const any_vector &other) const
+	{
+		if (other.ops_->type != ops_->type && *other.ops_->type != *ops_->type)
+			throw std::bad_cast();
+	}
+
+	void check_range(size_type pos, size_type count) const
+	{
+		if (pos > size_ || count > size_ - pos)
+			throw std::out_of_range("any_vector: range is past the end");
+	}
+
+	//Same growth policy as `my_vector`.
+	void ensure_space(size_type num_additional_elements)
+	{
+		if (capacity_ - size_ >= num_additional_elements)
+			return;
+
+		auto cap = capacity_ < 4 ? size_type(4) : capacity_;
+		if (num_additional_elements > (cap / 2))
+			cap = cap + num_additional_elements;
+
+		reallocate_storage(cap + (cap / 2));
+	}
+
+	//Relocates every element into newly allocated storage of `new_cap` elements.
+	void reallocate_storage(size_type new_cap)
+	{
+		auto new_first = static_cast<unsigned char*>(::operator new(new_cap * ops_->size));
+		try
+		{
+			ops_->relocate_range(new_first, first_, size_);
+		}
+		catch (...)
+		{
+			//The relocation destroyed all of our elements.
+			::operator delete(new_first);
+			size_ = 0;
+			throw;
+		}
+		::operator delete(first_);
+		first_ = new_first;
+		capacity_ = new_cap;
+	}
+
+	void clear_and_destroy() noexcept
+	{
+		clear();
+		::operator delete(first_);
+		nullify();
+	}
+
+	//Sets the storage pointer to nullptr, keeping the element type.
+	void nullify() noexcept
+	{
+		first_ = nullptr;
+		size_ = 0;
+		capacity_ = 0;
+	}
+};
+
+#endif //ANY_VECTOR_HEADER
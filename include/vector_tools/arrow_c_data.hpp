@@ -0,0 +1,351 @@
+#ifndef ARROW_C_DATA_HEADER
+#define ARROW_C_DATA_HEADER
+
+#include "my_vector.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+//The Apache Arrow C Data Interface structures, exactly as given by the specification.
+//The guard lets this header coexist with any other copy of them.
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+extern "C"
+{
+	struct ArrowSchema
+	{
+		//Array type description
+		const char *format;
+		const char *name;
+		const char *metadata;
+		int64_t flags;
+		int64_t n_children;
+		struct ArrowSchema **children;
+		struct ArrowSchema *dictionary;
+
+		//Release callback
+		void(*release)(struct ArrowSchema *);
+		//Opaque producer-specific data
+		void *private_data;
+	};
+
+	struct ArrowArray
+	{
+		//Array data description
+		int64_t length;
+		int64_t null_count;
+		int64_t offset;
+		int64_t n_buffers;
+		int64_t n_children;
+		const void **buffers;
+		struct ArrowArray **children;
+		struct ArrowArray *dictionary;
+
+		//Release callback
+		void(*release)(struct ArrowArray *);
+		//Opaque producer-specific data
+		void *private_data;
+	};
+}
+
+#endif //ARROW_C_DATA_INTERFACE
+
+namespace vector_tools
+{
+	namespace detail
+	{
+		///Returns the Arrow format string for an arithmetic type, or NULL if Arrow has no equivalent.
+		template<typename T>
+		constexpr const char *arrow_format()
+		{
+			return std::is_same<T, bool>::value ? "b" :
+				std::is_floating_point<T>::value ?
+					(sizeof(T) == 4 ? "f" : sizeof(T) == 8 ? "g" : nullptr) :
+				std::is_signed<T>::value ?
+					(sizeof(T) == 1 ? "c" : sizeof(T) == 2 ? "s" : sizeof(T) == 4 ? "i" : sizeof(T) == 8 ? "l" : nullptr) :
+					(sizeof(T) == 1 ? "C" : sizeof(T) == 2 ? "S" : sizeof(T) == 4 ? "I" : sizeof(T) == 8 ? "L" : nullptr);
+		}
+
+		///Owns the memory behind an exported `ArrowArray`.
+		///The release callback deletes it.
+		struct arrow_owner_base
+		{
+			virtual ~arrow_owner_base() = default;
+
+			const void *buffers[3] = {};
+		};
+
+		template<typename T>
+		struct arrow_vector_owner final : arrow_owner_base
+		{
+			explicit arrow_vector_owner(my_vector<T> &&vec) : values(std::move(vec))
+			{
+				buffers[1] = values.data();
+			}
+
+			my_vector<T> values;
+		};
+
+		struct arrow_string_owner final : arrow_owner_base
+		{
+			my_vector<std::int32_t> offsets;
+			my_vector<char> chars;
+		};
+
+		inline void release_arrow_array(ArrowArray *array)
+		{
+			delete static_cast<arrow_owner_base*>(array->private_data);
+			array->release = nullptr;
+		}
+
+		//Exported schemas only point to string literals, so there is nothing to free.
+		inline void release_arrow_schema(ArrowSchema *schema)
+		{
+			schema->release = nullptr;
+		}
+
+		inline void fill_arrow_schema(ArrowSchema *schema, const char *format)
+		{
+			schema->format = format;
+			schema->name = "";
+			schema->metadata = nullptr;
+			schema->flags = 0;
+			schema->n_children = 0;
+			schema->children = nullptr;
+			schema->dictionary = nullptr;
+			schema->release = &release_arrow_schema;
+			schema->private_data = nullptr;
+		}
+
+		inline void fill_arrow_array(ArrowArray *array, arrow_owner_base *owner,
+			std::size_t length, std::int64_t n_buffers)
+		{
+			array->length = std::int64_t(length);
+			array->null_count = 0;
+			array->offset = 0;
+			array->n_buffers = n_buffers;
+			array->n_children = 0;
+			array->buffers = owner->buffers;
+			array->children = nullptr;
+			array->dictionary = nullptr;
+			array->release = &release_arrow_array;
+			array->private_data = owner;
+		}
+	}
+
+	///Exports `vec` as a non-nullable Arrow array, without copying its elements.
+	///The vector's buffer is moved into the exported array and freed by its release callback.
+	///`array` and `schema` must point to uninitialized structures.
+	template<typename T>
+	std::enable_if_t<std::is_arithmetic<T>::value && !std::is_same<T, bool>::value>
+		export_to_arrow(my_vector<T> &&vec, ArrowArray *array, ArrowSchema *schema)
+	{
+		static_assert(detail::arrow_format<T>() != nullptr, "Type has no Arrow equivalent.");
+
+		auto length = vec.size();
+		auto owner = new detail::arrow_vector_owner<T>(std::move(vec));
+		detail::fill_arrow_array(array, owner, length, 2);
+		detail::fill_arrow_schema(schema, detail::arrow_format<T>());
+	}
+
+	///Exports `vec` as a non-nullable Arrow boolean array.
+	///Arrow booleans are bit-packed, so this packs the values into a new buffer.
+	inline void export_to_arrow(const my_vector<bool> &vec, ArrowArray *array, ArrowSchema *schema)
+	{
+		my_vector<std::uint8_t> bits((vec.size() + 7) / 8, std::uint8_t(0));
+		for (std::size_t ix = 0; ix < vec.size(); ++ix)
+			bits[ix / 8] |= std::uint8_t(vec[ix] ? 1u << (ix % 8) : 0u);
+
+		auto owner = new detail::arrow_vector_owner<std::uint8_t>(std::move(bits));
+		detail::fill_arrow_array(array, owner, vec.size(), 2);
+		detail::fill_arrow_schema(schema, "b");
+	}
+
+	///Exports `vec` as a non-nullable Arrow UTF-8 string array.
+	///The strings are gathered into one offsets buffer and one character buffer.
+	///Throws `std::length_error` if the total length does not fit 32-bit offsets.
+	inline void export_to_arrow(const my_vector<std::string> &vec, ArrowArray *array, ArrowSchema *schema)
+	{
+		std::size_t total = 0;
+		for (const auto &str : vec)
+			total += str.size();
+
+		if (total > std::size_t(std::numeric_limits<std::int32_t>::max()))
+			throw std::length_error("export_to_arrow: strings too long for 32-bit offsets");
+
+		auto owner = new detail::arrow_string_owner();
+		try
+		{
+			owner->offsets.reserve(vec.size() + 1);
+			owner->chars.resize(total);
+
+			std::int32_t offset = 0;
+			owner->offsets.push_back(offset);
+			for (const auto &str : vec)
+			{
+				if (!str.empty())
+					std::memcpy(owner->chars.data() + offset, str.data(), str.size());
+				offset += std::int32_t(str.size());
+				owner->offsets.push_back(offset);
+			}
+		}
+		catch (...)
+		{
+			delete owner;
+			throw;
+		}
+
+		owner->buffers[1] = owner->offsets.data();
+		owner->buffers[2] = owner->chars.data();
+		detail::fill_arrow_array(array, owner, vec.size(), 3);
+		detail::fill_arrow_schema(schema, "u");
+	}
+
+	namespace detail
+	{
+		///Takes ownership of an imported `ArrowArray`, releasing it on destruction.
+		class arrow_array_holder
+		{
+		public:
+			arrow_array_holder(ArrowArray *array, const ArrowSchema &schema,
+				const char *format, std::int64_t n_buffers)
+			{
+				if (!array || !array->release)
+					throw std::invalid_argument("arrow import: array is released");
+				if (std::strcmp(schema.format, format) != 0)
+					throw std::invalid_argument("arrow import: format does not match element type");
+				if (array->n_buffers != n_buffers)
+					throw std::invalid_argument("arrow import: unexpected buffer count");
+
+				//Move the array, as the specification describes.
+				array_ = *array;
+				array->release = nullptr;
+			}
+
+			arrow_array_holder(arrow_array_holder &&other) noexcept
+				: array_(other.array_)
+			{
+				other.array_.release = nullptr;
+			}
+
+			arrow_array_holder &operator=(arrow_array_holder &&other) noexcept
+			{
+				if (this == &other)
+					return *this;
+
+				release();
+				array_ = other.array_;
+				other.array_.release = nullptr;
+				return *this;
+			}
+
+			~arrow_array_holder()
+			{
+				release();
+			}
+
+			std::size_t size() const noexcept { return std::size_t(array_.length); }
+			std::size_t null_count() const noexcept { return std::size_t(array_.null_count); }
+
+			///False if the element at `ix` is null.
+			bool is_valid(std::size_t ix) const noexcept
+			{
+				auto validity = static_cast<const std::uint8_t*>(array_.buffers[0]);
+				if (array_.null_count == 0 || !validity)
+					return true;
+
+				auto bit = std::size_t(array_.offset) + ix;
+				return (validity[bit / 8] >> (bit % 8)) & 1;
+			}
+
+		protected:
+			ArrowArray array_;
+
+			void release() noexcept
+			{
+				if (array_.release)
+					array_.release(&array_);
+			}
+		};
+	}
+
+	///A read-only view of an imported Arrow array of arithmetic `T`s.
+	///The view owns the imported array and releases it when destroyed.
+	///Element access reads the producer's buffer directly; nothing is copied.
+	template<typename T>
+	class arrow_array_view : public detail::arrow_array_holder
+	{
+	public:
+		static_assert(std::is_arithmetic<T>::value, "Only arithmetic types have fixed-width views.");
+
+		///Takes ownership of `array`, leaving it released.
+		///Throws `std::invalid_argument` if `schema` does not describe an array of `T`.
+		arrow_array_view(ArrowArray *array, const ArrowSchema &schema)
+			: arrow_array_holder(array, schema, detail::arrow_format<T>(), 2)
+		{}
+
+		const T *data() const noexcept
+		{
+			return static_cast<const T*>(array_.buffers[1]) + array_.offset;
+		}
+
+		const T &operator[](std::size_t ix) const noexcept { return data()[ix]; }
+
+		const T *begin() const noexcept { return data(); }
+		const T *end() const noexcept { return data() + size(); }
+	};
+
+	///A read-only view of an imported Arrow boolean array.
+	template<>
+	class arrow_array_view<bool> : public detail::arrow_array_holder
+	{
+	public:
+		arrow_array_view(ArrowArray *array, const ArrowSchema &schema)
+			: arrow_array_holder(array, schema, "b", 2)
+		{}
+
+		bool operator[](std::size_t ix) const noexcept
+		{
+			auto bits = static_cast<const std::uint8_t*>(array_.buffers[1]);
+			auto bit = std::size_t(array_.offset) + ix;
+			return (bits[bit / 8] >> (bit % 8)) & 1;
+		}
+	};
+
+	///A read-only view of an imported Arrow UTF-8 string array.
+	class arrow_string_view : public detail::arrow_array_holder
+	{
+	public:
+		///A reference to the characters of one string, which are not NUL-terminated.
+		struct element
+		{
+			const char *data;
+			std::size_t size;
+
+			std::string str() const { return std::string(data, size); }
+		};
+
+		arrow_string_view(ArrowArray *array, const ArrowSchema &schema)
+			: arrow_array_holder(array, schema, "u", 3)
+		{}
+
+		element operator[](std::size_t ix) const noexcept
+		{
+			auto offsets = static_cast<const std::int32_t*>(array_.buffers[1]) + array_.offset;
+			auto chars = static_cast<const char*>(array_.buffers[2]);
+			return { chars + offsets[ix], std::size_t(offsets[ix + 1] - offsets[ix]) };
+		}
+	};
+}
+
+#endif //ARROW_C_DATA_HEADER
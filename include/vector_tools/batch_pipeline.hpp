@@ -0,0 +1,511 @@
+#ifndef BATCH_PIPELINE_HEADER
+#define BATCH_PIPELINE_HEADER
+
+#if !defined(__cpp_impl_coroutine)
+#error "batch_pipeline.hpp requires C++20 coroutines."
+#endif
+
+#include "my_vector.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+///A thread-safe pool of emptied batches, so that pipeline stages reuse buffers instead of allocating.
+///Recycled batches are cleared, keeping their capacity.
+///The pool's own storage is reserved up front, so once it holds enough batches
+///neither acquiring nor recycling allocates.
+template<typename T>
+class batch_pool
+{
+public:
+	using batch_type = my_vector<T>;
+	using size_type = std::size_t;
+
+	///Batches are created with room for `batch_capacity` elements.
+	///At most `max_pooled` batches are kept; any recycled beyond that are freed.
+	batch_pool(size_type batch_capacity, size_type max_pooled)
+		: batch_capacity_(batch_capacity), max_pooled_(max_pooled)
+	{
+		free_.reserve(max_pooled);
+	}
+
+	batch_pool(const batch_pool &) = delete;
+	batch_pool &operator=(const batch_pool &) = delete;
+
+	///Allocates batches until `count` are pooled, so that none need allocating later.
+	///A pipeline never has more batches in flight than its channels' capacities plus one per stage.
+	void prefill(size_type count)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		count = std::min(count, max_pooled_);
+		while (free_.size() < count)
+		{
+			batch_type batch;
+			batch.reserve(batch_capacity_);
+			free_.push_back(std::move(batch));
+		}
+	}
+
+	///Returns an empty batch, reusing a recycled one if there is one.
+	batch_type acquire()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (!free_.empty())
+			{
+				batch_type batch(std::move(free_.back()));
+				free_.pop_back();
+				return batch;
+			}
+		}
+
+		batch_type batch;
+		batch.reserve(batch_capacity_);
+		return batch;
+	}
+
+	///Clears `batch` and keeps its storage for a later `acquire`.
+	void recycle(batch_type &&batch)
+	{
+		if (batch.capacity() == 0)
+			return;
+
+		batch.clear();
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (free_.size() < max_pooled_)
+			free_.push_back(std::move(batch));
+	}
+
+	///The number of batches waiting to be reused.
+	size_type pooled() const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		return free_.size();
+	}
+
+private:
+	size_type batch_capacity_;
+	size_type max_pooled_;
+	mutable std::mutex mutex_;
+	my_vector<batch_type> free_;
+};
+
+class pipeline_executor;
+
+///A pipeline stage: a coroutine started by `pipeline_executor::spawn`.
+///It runs on the executor's threads, and is resumed there whenever a channel
+///operation it is waiting on completes.
+class pipeline_task
+{
+public:
+	struct promise_type;
+	using handle_type = std::coroutine_handle<promise_type>;
+
+	pipeline_task(pipeline_task &&other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+	pipeline_task(const pipeline_task &) = delete;
+	pipeline_task &operator=(const pipeline_task &) = delete;
+
+	~pipeline_task()
+	{
+		//Never spawned.
+		if (handle_)
+			handle_.destroy();
+	}
+
+private:
+	friend class pipeline_executor;
+
+	handle_type handle_;
+
+	explicit pipeline_task(handle_type handle) noexcept : handle_(handle) {}
+};
+
+///A fixed set of threads that run pipeline stages.
+///Suspended stages take no thread; when a channel operation a stage waits on completes,
+///the stage is queued to resume on whichever thread is free.
+class pipeline_executor
+{
+public:
+	using size_type = std::size_t;
+
+	///Starts `thread_count` threads, or one per hardware thread if it is 0.
+	explicit pipeline_executor(unsigned thread_count = 0)
+	{
+		if (thread_count == 0)
+			thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+		ready_.resize(16);
+		threads_.reserve(thread_count);
+		try
+		{
+			for (unsigned ix = 0; ix < thread_count; ++ix)
+				threads_.emplace_back([this] { run(); });
+		}
+		catch (...)
+		{
+			stop();
+			throw;
+		}
+	}
+
+	pipeline_executor(const pipeline_executor &) = delete;
+	pipeline_executor &operator=(const pipeline_executor &) = delete;
+
+	///Stops the threads. Call `wait` first; stages that have not finished are abandoned.
+	~pipeline_executor()
+	{
+		stop();
+	}
+
+	///Queues `task` to start on one of the executor's threads.
+	void spawn(pipeline_task task);
+
+	///Blocks until every spawned stage has finished, then rethrows the first exception
+	///that escaped any of them.
+	///A stage that fails should still close its output channels, or the stages
+	///downstream of it will wait forever.
+	void wait()
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		idle_.wait(lock, [this] { return running_ == 0; });
+		if (error_)
+			std::rethrow_exception(std::exchange(error_, nullptr));
+	}
+
+	///Queues `handle` to be resumed on one of the executor's threads.
+	void schedule(std::coroutine_handle<> handle)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (ready_count_ == ready_.size())
+				grow_ready();
+
+			ready_[(ready_head_ + ready_count_) & (ready_.size() - 1)] = handle;
+			++ready_count_;
+		}
+		wake_.notify_one();
+	}
+
+private:
+	friend struct pipeline_task::promise_type;
+
+	std::mutex mutex_;
+	std::condition_variable wake_;
+	std::condition_variable idle_;
+	//A ring of coroutines waiting for a thread. Its size is a power of two.
+	my_vector<std::coroutine_handle<>> ready_;
+	size_type ready_head_ = 0;
+	size_type ready_count_ = 0;
+	size_type running_ = 0;
+	bool stopping_ = false;
+	std::exception_ptr error_;
+	my_vector<std::thread> threads_;
+
+	void run()
+	{
+		while (true)
+		{
+			std::coroutine_handle<> next;
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				wake_.wait(lock, [this] { return stopping_ || ready_count_ != 0; });
+				if (ready_count_ == 0)
+					return;
+
+				next = ready_[ready_head_];
+				ready_head_ = (ready_head_ + 1) & (ready_.size() - 1);
+				--ready_count_;
+			}
+			next.resume();
+		}
+	}
+
+	void stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stopping_ = true;
+		}
+		wake_.notify_all();
+		for (auto &thread : threads_)
+			thread.join();
+		threads_.clear();
+	}
+
+	//Doubles the ready ring, unwrapping it so that the queued coroutines start at index 0.
+	void grow_ready()
+	{
+		my_vector<std::coroutine_handle<>> bigger(ready_.size() * 2);
+		for (size_type ix = 0; ix < ready_count_; ++ix)
+			bigger[ix] = ready_[(ready_head_ + ix) & (ready_.size() - 1)];
+
+		ready_ = std::move(bigger);
+		ready_head_ = 0;
+	}
+
+	void finished(std::exception_ptr error) noexcept
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (error && !error_)
+			error_ = std::move(error);
+
+		if (--running_ == 0)
+			idle_.notify_all();
+	}
+};
+
+struct pipeline_task::promise_type
+{
+	pipeline_executor *executor = nullptr;
+	std::exception_ptr error;
+
+	pipeline_task get_return_object() noexcept { return pipeline_task(handle_type::from_promise(*this)); }
+
+	std::suspend_always initial_suspend() noexcept { return {}; }
+
+	//The stage's locals are already gone by now, so the frame can be freed as soon as
+	//the executor has been told.
+	std::suspend_never final_suspend() noexcept
+	{
+		executor->finished(std::move(error));
+		return {};
+	}
+
+	void return_void() noexcept {}
+	void unhandled_exception() noexcept { error = std::current_exception(); }
+};
+
+inline void pipeline_executor::spawn(pipeline_task task)
+{
+	auto handle = std::exchange(task.handle_, nullptr);
+	handle.promise().executor = this;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		++running_;
+	}
+	schedule(handle);
+}
+
+///A bounded, multi-producer/multi-consumer queue of batches between pipeline stages.
+///A stage pushing into a full channel is suspended until a batch is popped,
+///so a slow stage holds back the stages feeding it rather than letting batches pile up.
+///Batches are moved through the channel; its ring of slots is allocated once, up front.
+template<typename T>
+class batch_channel
+{
+public:
+	using batch_type = my_vector<T>;
+	using size_type = std::size_t;
+
+	///Creates a channel that holds up to `capacity` batches.
+	///Suspended stages are resumed on `executor`.
+	batch_channel(pipeline_executor &executor, size_type capacity)
+		: executor_(executor), slots_(capacity)
+	{
+		if (capacity == 0)
+			throw std::length_error("batch_channel: capacity must be positive");
+	}
+
+	batch_channel(const batch_channel &) = delete;
+	batch_channel &operator=(const batch_channel &) = delete;
+
+	class push_awaiter;
+	class pop_awaiter;
+
+	///`co_await`ing this moves `batch` into the channel, suspending while the channel is full.
+	///Throws `std::logic_error` if the channel has been closed.
+	push_awaiter push(batch_type &&batch) noexcept { return push_awaiter(*this, batch); }
+
+	///`co_await`ing this moves the next batch into `out` and yields true,
+	///suspending while the channel is empty. Yields false once the channel is closed and drained.
+	pop_awaiter pop(batch_type &out) noexcept { return pop_awaiter(*this, out); }
+
+	///Marks the end of the stream, once every producer is done.
+	///Stages waiting to pop are resumed; they receive the batches still in the channel, then false.
+	void close()
+	{
+		pop_awaiter *waiting;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			closed_ = true;
+			waiting = std::exchange(poppers_.first, nullptr);
+			poppers_.last = nullptr;
+		}
+
+		while (waiting)
+		{
+			//The awaiter lives in the frame being resumed, so read its link first.
+			auto next = waiting->next_;
+			waiting->result_ = false;
+			executor_.schedule(waiting->handle_);
+			waiting = next;
+		}
+	}
+
+	class push_awaiter
+	{
+	public:
+		bool await_ready() const noexcept { return false; }
+
+		bool await_suspend(std::coroutine_handle<> handle)
+		{
+			handle_ = handle;
+			return channel_.begin_push(*this);
+		}
+
+		void await_resume() const noexcept {}
+
+	private:
+		friend class batch_channel;
+
+		batch_channel &channel_;
+		batch_type &batch_;
+		std::coroutine_handle<> handle_;
+		push_awaiter *next_ = nullptr;
+
+		push_awaiter(batch_channel &channel, batch_type &batch) noexcept : channel_(channel), batch_(batch) {}
+	};
+
+	class pop_awaiter
+	{
+	public:
+		bool await_ready() const noexcept { return false; }
+
+		bool await_suspend(std::coroutine_handle<> handle)
+		{
+			handle_ = handle;
+			return channel_.begin_pop(*this);
+		}
+
+		bool await_resume() const noexcept { return result_; }
+
+	private:
+		friend class batch_channel;
+
+		batch_channel &channel_;
+		batch_type &out_;
+		std::coroutine_handle<> handle_;
+		pop_awaiter *next_ = nullptr;
+		bool result_ = false;
+
+		pop_awaiter(batch_channel &channel, batch_type &out) noexcept : channel_(channel), out_(out) {}
+	};
+
+private:
+	//A FIFO of suspended stages, linked through awaiters that live in their coroutine frames.
+	template<typename Awaiter>
+	struct wait_list
+	{
+		Awaiter *first = nullptr;
+		Awaiter *last = nullptr;
+
+		void push(Awaiter &awaiter) noexcept
+		{
+			awaiter.next_ = nullptr;
+			if (last)
+				last->next_ = &awaiter;
+			else
+				first = &awaiter;
+			last = &awaiter;
+		}
+
+		Awaiter *pop() noexcept
+		{
+			auto front = first;
+			if (front)
+			{
+				first = front->next_;
+				if (!first)
+					last = nullptr;
+			}
+			return front;
+		}
+	};
+
+	pipeline_executor &executor_;
+	std::mutex mutex_;
+	my_vector<batch_type> slots_;
+	size_type head_ = 0;
+	size_type count_ = 0;
+	bool closed_ = false;
+	wait_list<push_awaiter> pushers_;
+	wait_list<pop_awaiter> poppers_;
+
+	//Each returns true if the coroutine must stay suspended.
+	//Once one has returned true, another thread may resume the coroutine at any moment,
+	//so the awaiter must not be touched again.
+
+	bool begin_push(push_awaiter &awaiter)
+	{
+		pop_awaiter *receiver;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (closed_)
+				throw std::logic_error("batch_channel: push after close");
+
+			receiver = poppers_.pop();
+			if (!receiver)
+			{
+				if (count_ == slots_.size())
+				{
+					pushers_.push(awaiter);
+					return true;
+				}
+
+				slots_[(head_ + count_) % slots_.size()] = std::move(awaiter.batch_);
+				++count_;
+				return false;
+			}
+		}
+
+		//A consumer is already waiting, so hand the batch straight to it.
+		receiver->out_ = std::move(awaiter.batch_);
+		receiver->result_ = true;
+		executor_.schedule(receiver->handle_);
+		return false;
+	}
+
+	bool begin_pop(pop_awaiter &awaiter)
+	{
+		push_awaiter *sender;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (count_ == 0)
+			{
+				if (closed_)
+				{
+					awaiter.result_ = false;
+					return false;
+				}
+
+				poppers_.push(awaiter);
+				return true;
+			}
+
+			awaiter.out_ = std::move(slots_[head_]);
+			awaiter.result_ = true;
+			head_ = (head_ + 1) % slots_.size();
+			--count_;
+
+			//Make room for the longest-waiting producer, which can now continue.
+			sender = pushers_.pop();
+			if (sender)
+			{
+				slots_[(head_ + count_) % slots_.size()] = std::move(sender->batch_);
+				++count_;
+			}
+		}
+
+		if (sender)
+			executor_.schedule(sender->handle_);
+		return false;
+	}
+};
+
+#endif //BATCH_PIPELINE_HEADER
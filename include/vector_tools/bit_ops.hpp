@@ -0,0 +1,52 @@
+#ifndef VECTOR_TOOLS_BIT_OPS_HEADER
+#define VECTOR_TOOLS_BIT_OPS_HEADER
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace vector_tools
+{
+	///The number of set bits in `word`.
+	inline unsigned popcount(std::uint64_t word) noexcept
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		return unsigned(__builtin_popcountll(word));
+#else
+		word = word - ((word >> 1) & 0x5555555555555555ull);
+		word = (word & 0x3333333333333333ull) + ((word >> 2) & 0x3333333333333333ull);
+		word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+		return unsigned((word * 0x0101010101010101ull) >> 56);
+#endif
+	}
+
+	///The index of the lowest set bit in `word`, which must not be 0.
+	inline unsigned count_trailing_zeros(std::uint64_t word) noexcept
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		return unsigned(__builtin_ctzll(word));
+#elif defined(_MSC_VER) && defined(_M_X64)
+		unsigned long index;
+		_BitScanForward64(&index, word);
+		return unsigned(index);
+#else
+		return popcount((word & (0 - word)) - 1);
+#endif
+	}
+
+	///Calls `func(index)` for each set bit of `word`, lowest first, adding `base` to the bit index.
+	template<typename Func>
+	void for_each_set_bit(std::uint64_t word, std::size_t base, Func &&func)
+	{
+		while (word != 0)
+		{
+			func(base + count_trailing_zeros(word));
+			word &= word - 1;
+		}
+	}
+}
+
+#endif //VECTOR_TOOLS_BIT_OPS_HEADER
@@ -0,0 +1,910 @@
+#ifndef BPLUS_TREE_HEADER
+#define BPLUS_TREE_HEADER
+
+#include "my_vector.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace detail
+{
+	///Storage for up to `N` `T`s, constructed and destroyed by its owner.
+	template<typename T, std::size_t N>
+	struct uninitialized_array
+	{
+		alignas(T) unsigned char bytes[sizeof(T) * N];
+
+		T *data() noexcept { return reinterpret_cast<T*>(bytes); }
+		const T *data() const noexcept { return reinterpret_cast<const T*>(bytes); }
+		T &operator[](std::size_t ix) noexcept { return data()[ix]; }
+		const T &operator[](std::size_t ix) const noexcept { return data()[ix]; }
+	};
+
+	///True if a node's keys can be searched by counting the smaller ones without branching,
+	///which compilers turn into vector compares.
+	template<typename Key, typename Compare>
+	struct is_counting_searchable : std::integral_constant<bool,
+		std::is_arithmetic<Key>::value && std::is_same<Compare, std::less<Key>>::value>
+	{};
+}
+
+///An ordered map from unique `Key`s to `T`s, stored as a B+tree.
+///Every node is a fixed-capacity array: leaves hold up to `Capacity` keys and, in a separate array,
+///their values; inner nodes hold up to `Capacity` separator keys and one more child.
+///Lookups therefore search a few contiguous arrays rather than chasing a pointer per comparison,
+///and leaves are linked in key order, so range scans walk arrays from one leaf to the next.
+///Nodes are split ahead of an insertion and refilled ahead of an erasure on the way down,
+///so both are a single pass from the root.
+///Keys and values must be nothrow movable. Given that, every operation either succeeds
+///or throws without changing the tree's contents.
+///Inserting or erasing invalidates all iterators.
+template<typename Key, typename T, typename Compare = std::less<Key>, std::size_t Capacity = 64>
+class bplus_tree
+{
+public:
+	static_assert(Capacity >= 4, "Nodes must hold at least 4 keys.");
+	static_assert(std::is_nothrow_move_constructible<Key>::value && std::is_nothrow_move_assignable<Key>::value,
+		"Keys must be nothrow movable.");
+	static_assert(std::is_nothrow_move_constructible<T>::value && std::is_nothrow_move_assignable<T>::value,
+		"Values must be nothrow movable.");
+
+	using key_type = Key;
+	using mapped_type = T;
+	using key_compare = Compare;
+	using size_type = std::size_t;
+
+private:
+	struct node_base
+	{
+		explicit node_base(bool is_leaf) noexcept : is_leaf(is_leaf) {}
+
+		bool is_leaf;
+		size_type count = 0;
+	};
+
+	struct leaf_node : node_base
+	{
+		leaf_node() noexcept : node_base(true) {}
+
+		leaf_node *next = nullptr;
+		detail::uninitialized_array<Key, Capacity> keys;
+		detail::uninitialized_array<T, Capacity> values;
+	};
+
+	//Child `ix` holds the keys from `keys[ix - 1]` up to, but not including, `keys[ix]`.
+	struct inner_node : node_base
+	{
+		inner_node() noexcept : node_base(false) {}
+
+		detail::uninitialized_array<Key, Capacity> keys;
+		node_base *children[Capacity + 1];
+	};
+
+public:
+	///What an iterator points to: a key and its value, which are not stored side by side.
+	template<typename Value>
+	struct basic_reference
+	{
+		const Key &first;
+		Value &second;
+	};
+
+	///A forward iterator over the entries, in key order.
+	template<bool Const>
+	class basic_iterator
+	{
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = std::pair<const Key, T>;
+		using difference_type = std::ptrdiff_t;
+		using reference = basic_reference<std::conditional_t<Const, const T, T>>;
+		using pointer = void;
+
+		basic_iterator() noexcept = default;
+
+		//Iterators convert to const_iterators.
+		template<bool OtherConst, typename = std::enable_if_t<Const && !OtherConst>>
+		basic_iterator(const basic_iterator<OtherConst> &other) noexcept : leaf_(other.leaf_), ix_(other.ix_) {}
+
+		const Key &key() const noexcept { return leaf_->keys[ix_]; }
+		std::conditional_t<Const, const T, T> &value() const noexcept { return leaf_->values[ix_]; }
+		reference operator*() const noexcept { return { key(), value() }; }
+
+		basic_iterator &operator++() noexcept
+		{
+			if (++ix_ == leaf_->count)
+			{
+				leaf_ = leaf_->next;
+				ix_ = 0;
+			}
+			return *this;
+		}
+
+		basic_iterator operator++(int) noexcept
+		{
+			auto temp = *this;
+			++*this;
+			return temp;
+		}
+
+		friend bool operator==(const basic_iterator &lhs, const basic_iterator &rhs) noexcept
+		{
+			return lhs.leaf_ == rhs.leaf_ && lhs.ix_ == rhs.ix_;
+		}
+
+		friend bool operator!=(const basic_iterator &lhs, const basic_iterator &rhs) noexcept { return !(lhs == rhs); }
+
+	private:
+		friend class bplus_tree;
+		template<bool> friend class basic_iterator;
+
+		leaf_node *leaf_ = nullptr;
+		size_type ix_ = 0;
+
+		//A position one past the end of a leaf is normalized to the start of the next.
+		basic_iterator(leaf_node *leaf, size_type ix) noexcept : leaf_(leaf), ix_(ix)
+		{
+			if (leaf_ && ix_ == leaf_->count)
+			{
+				leaf_ = leaf_->next;
+				ix_ = 0;
+			}
+		}
+	};
+
+	using iterator = basic_iterator<false>;
+	using const_iterator = basic_iterator<true>;
+
+	explicit bplus_tree(const Compare &comp = Compare()) : comp_(comp) {}
+
+	bplus_tree(const bplus_tree &other) : comp_(other.comp_)
+	{
+		auto leaf = other.head_;
+		size_type ix = 0;
+		build(other.size_, [&](leaf_node &out, size_type count) {
+			for (; count != 0; --count)
+			{
+				push_entry(out, leaf->keys[ix], leaf->values[ix]);
+				if (++ix == leaf->count)
+				{
+					leaf = leaf->next;
+					ix = 0;
+				}
+			}
+		});
+	}
+
+	bplus_tree(bplus_tree &&other) noexcept : comp_(other.comp_)
+	{
+		swap(other);
+	}
+
+	~bplus_tree()
+	{
+		clear();
+	}
+
+	bplus_tree &operator=(const bplus_tree &other)
+	{
+		bplus_tree temp(other);
+		swap(temp);
+		return *this;
+	}
+
+	bplus_tree &operator=(bplus_tree &&other) noexcept
+	{
+		bplus_tree temp(std::move(other));
+		swap(temp);
+		return *this;
+	}
+
+	void swap(bplus_tree &other) noexcept
+	{
+		using std::swap;
+		swap(comp_, other.comp_);
+		swap(root_, other.root_);
+		swap(head_, other.head_);
+		swap(size_, other.size_);
+		swap(height_, other.height_);
+	}
+
+	size_type size() const noexcept { return size_; }
+	bool empty() const noexcept { return size_ == 0; }
+
+	///The number of levels of nodes, counting the leaves.
+	size_type height() const noexcept { return height_; }
+
+	key_compare key_comp() const { return comp_; }
+
+	void clear() noexcept
+	{
+		if (root_)
+			destroy_subtree(root_);
+		root_ = nullptr;
+		head_ = nullptr;
+		size_ = 0;
+		height_ = 0;
+	}
+
+	///Replaces the contents with `keys` and their `values`, building the tree bottom-up in linear time.
+	///The keys must be sorted and unique, and there must be as many of them as values.
+	void assign_sorted(const my_vector<Key> &keys, const my_vector<T> &values)
+	{
+		assign_sorted(keys, values, keys.begin(), values.begin());
+	}
+
+	///As above, moving the keys and values out of the vectors.
+	void assign_sorted(my_vector<Key> &&keys, my_vector<T> &&values)
+	{
+		assign_sorted(keys, values, std::make_move_iterator(keys.begin()), std::make_move_iterator(values.begin()));
+	}
+
+	iterator begin() noexcept { return iterator(head_, 0); }
+	iterator end() noexcept { return iterator(); }
+	const_iterator begin() const noexcept { return const_iterator(head_, 0); }
+	const_iterator end() const noexcept { return const_iterator(); }
+	const_iterator cbegin() const noexcept { return begin(); }
+	const_iterator cend() const noexcept { return end(); }
+
+	iterator find(const Key &key)
+	{
+		auto entry = find_leaf_entry(key);
+		return entry.first ? iterator(entry.first, entry.second) : end();
+	}
+
+	const_iterator find(const Key &key) const
+	{
+		return const_cast<bplus_tree*>(this)->find(key);
+	}
+
+	bool contains(const Key &key) const { return find_leaf_entry(key).first != nullptr; }
+
+	///The first entry whose key is not less than `key`.
+	iterator lower_bound(const Key &key)
+	{
+		auto leaf = find_leaf(key);
+		return leaf ? iterator(leaf, lower_index(leaf->keys.data(), leaf->count, key)) : end();
+	}
+
+	const_iterator lower_bound(const Key &key) const
+	{
+		return const_cast<bplus_tree*>(this)->lower_bound(key);
+	}
+
+	///The first entry whose key is greater than `key`.
+	iterator upper_bound(const Key &key)
+	{
+		auto leaf = find_leaf(key);
+		return leaf ? iterator(leaf, upper_index(leaf->keys.data(), leaf->count, key)) : end();
+	}
+
+	const_iterator upper_bound(const Key &key) const
+	{
+		return const_cast<bplus_tree*>(this)->upper_bound(key);
+	}
+
+	///Calls `func(key, value)` for each entry whose key is in `[lo, hi)`, in order.
+	///The scan runs over each leaf's arrays in turn, stopping at the first key not less than `hi`.
+	template<typename Func>
+	void for_each_range(const Key &lo, const Key &hi, Func &&func) const
+	{
+		auto leaf = find_leaf(lo);
+		if (!leaf)
+			return;
+
+		auto ix = lower_index(leaf->keys.data(), leaf->count, lo);
+		for (; leaf; leaf = leaf->next, ix = 0)
+		{
+			auto stop = lower_index(leaf->keys.data(), leaf->count, hi);
+			for (; ix < stop; ++ix)
+				func(leaf->keys[ix], leaf->values[ix]);
+			if (stop != leaf->count)
+				return;
+		}
+	}
+
+	///Adds `key` with `value`, unless `key` is already present.
+	///Returns the entry for `key`, and whether it was added.
+	std::pair<iterator, bool> insert(const Key &key, const T &value)
+	{
+		return emplace(key, value);
+	}
+
+	std::pair<iterator, bool> insert(Key &&key, T &&value)
+	{
+		return emplace(std::move(key), std::move(value));
+	}
+
+	///Adds `key` with a value made from `args`, unless `key` is already present.
+	///The value is only made if the key is added.
+	template<typename K, typename ...Args>
+	std::pair<iterator, bool> emplace(K &&key, Args &&...args)
+	{
+		//Make the entry before changing anything, so that a throwing copy leaves the tree alone.
+		Key new_key(std::forward<K>(key));
+		auto leaf = leaf_for_insert(new_key);
+		auto pos = lower_index(leaf->keys.data(), leaf->count, new_key);
+		if (pos != leaf->count && !comp_(new_key, leaf->keys[pos]))
+			return { iterator(leaf, pos), false };
+
+		T new_value(std::forward<Args>(args)...);
+		insert_at(leaf->keys.data(), leaf->count, pos, std::move(new_key));
+		insert_at(leaf->values.data(), leaf->count, pos, std::move(new_value));
+		++leaf->count;
+		++size_;
+		return { iterator(leaf, pos), true };
+	}
+
+	///Sets the value for `key`, adding it if need be.
+	template<typename V>
+	std::pair<iterator, bool> insert_or_assign(const Key &key, V &&value)
+	{
+		auto result = emplace(key, std::forward<V>(value));
+		if (!result.second)
+			result.first.value() = std::forward<V>(value);
+		return result;
+	}
+
+	///The value for `key`, adding a value-initialized one if need be.
+	T &operator[](const Key &key)
+	{
+		return emplace(key).first.value();
+	}
+
+	///The value for `key`, which must be present.
+	T &at(const Key &key)
+	{
+		auto entry = find_leaf_entry(key);
+		if (!entry.first)
+			throw std::out_of_range("bplus_tree: key not found");
+		return entry.first->values[entry.second];
+	}
+
+	const T &at(const Key &key) const
+	{
+		return const_cast<bplus_tree*>(this)->at(key);
+	}
+
+	///Removes `key`, if present. Returns the number of entries removed.
+	size_type erase(const Key &key)
+	{
+		if (!root_)
+			return 0;
+
+		auto curr = root_;
+		while (!curr->is_leaf)
+		{
+			auto inner = static_cast<inner_node*>(curr);
+			auto ix = upper_index(inner->keys.data(), inner->count, key);
+			if (inner->children[ix]->count <= min_count(inner->children[ix]))
+				ix = refill_child(*inner, ix);
+			curr = inner->children[ix];
+		}
+
+		auto leaf = static_cast<leaf_node*>(curr);
+		auto pos = lower_index(leaf->keys.data(), leaf->count, key);
+		auto found = pos != leaf->count && !comp_(key, leaf->keys[pos]);
+		if (found)
+		{
+			erase_at(leaf->keys.data(), leaf->count, pos);
+			erase_at(leaf->values.data(), leaf->count, pos);
+			--leaf->count;
+			--size_;
+		}
+
+		shrink_root();
+		return found ? 1 : 0;
+	}
+
+private:
+	//Leaves and inner nodes other than the root never hold fewer keys than this.
+	//An inner node's minimum is lower, since merging two inner nodes also brings down their separator.
+	static constexpr size_type min_leaf_count = Capacity / 2;
+	static constexpr size_type min_inner_count = (Capacity - 1) / 2;
+
+	Compare comp_;
+	node_base *root_ = nullptr;
+	//The first leaf, where iteration starts.
+	leaf_node *head_ = nullptr;
+	size_type size_ = 0;
+	size_type height_ = 0;
+
+	static size_type min_count(const node_base *node) noexcept
+	{
+		return node->is_leaf ? min_leaf_count : min_inner_count;
+	}
+
+	//The number of keys in `keys[0, count)` that are less than `key`.
+	size_type lower_index(const Key *keys, size_type count, const Key &key) const
+	{
+		return lower_index(keys, count, key, detail::is_counting_searchable<Key, Compare>{});
+	}
+
+	size_type lower_index(const Key *keys, size_type count, const Key &key, std::true_type) const noexcept
+	{
+		size_type less = 0;
+		for (size_type ix = 0; ix != count; ++ix)
+			less += keys[ix] < key;
+		return less;
+	}
+
+	size_type lower_index(const Key *keys, size_type count, const Key &key, std::false_type) const
+	{
+		return size_type(std::lower_bound(keys, keys + count, key, comp_) - keys);
+	}
+
+	//The number of keys in `keys[0, count)` that are not greater than `key`.
+	size_type upper_index(const Key *keys, size_type count, const Key &key) const
+	{
+		return upper_index(keys, count, key, detail::is_counting_searchable<Key, Compare>{});
+	}
+
+	size_type upper_index(const Key *keys, size_type count, const Key &key, std::true_type) const noexcept
+	{
+		size_type not_greater = 0;
+		for (size_type ix = 0; ix != count; ++ix)
+			not_greater += !(key < keys[ix]);
+		return not_greater;
+	}
+
+	size_type upper_index(const Key *keys, size_type count, const Key &key, std::false_type) const
+	{
+		return size_type(std::upper_bound(keys, keys + count, key, comp_) - keys);
+	}
+
+	leaf_node *find_leaf(const Key &key) const
+	{
+		auto curr = root_;
+		if (!curr)
+			return nullptr;
+
+		while (!curr->is_leaf)
+		{
+			auto inner = static_cast<inner_node*>(curr);
+			curr = inner->children[upper_index(inner->keys.data(), inner->count, key)];
+		}
+		return static_cast<leaf_node*>(curr);
+	}
+
+	//The leaf and position of `key`, or a null leaf if it is absent.
+	std::pair<leaf_node*, size_type> find_leaf_entry(const Key &key) const
+	{
+		auto leaf = find_leaf(key);
+		if (!leaf)
+			return { nullptr, 0 };
+
+		auto pos = lower_index(leaf->keys.data(), leaf->count, key);
+		if (pos == leaf->count || comp_(key, leaf->keys[pos]))
+			return { nullptr, 0 };
+		return { leaf, pos };
+	}
+
+	//Inserts `value` at `first[pos]`, shifting `first[pos, count)` up one into unconstructed storage.
+	template<typename U>
+	static void insert_at(U *first, size_type count, size_type pos, U &&value) noexcept
+	{
+		std::allocator<U> alloc;
+		if (pos == count)
+		{
+			std::allocator_traits<std::allocator<U>>::construct(alloc, first + count, std::move(value));
+			return;
+		}
+
+		auto part = vector_tools::safemove_partition_right(first + pos, first + count, alloc, first + count + 1);
+		*part.first = std::move(value);
+	}
+
+	//Removes `first[pos]`, shifting `first[pos + 1, count)` down one and destroying the last element.
+	template<typename U>
+	static void erase_at(U *first, size_type count, size_type pos) noexcept
+	{
+		std::allocator<U> alloc;
+		vector_tools::safemove_assign_shift_left(first + pos, first + pos + 1, first + count);
+		vector_tools::destroy_range(first + count - 1, first + count, alloc);
+	}
+
+	//Moves `count` elements from `input` into the unconstructed storage at `output`.
+	template<typename U>
+	static void relocate(U *output, U *input, size_type count) noexcept
+	{
+		std::allocator<U> alloc;
+		vector_tools::relocate_range(output, alloc, input, input + count);
+	}
+
+	static void destroy_node(node_base *node) noexcept
+	{
+		if (node->is_leaf)
+		{
+			auto leaf = static_cast<leaf_node*>(node);
+			vector_tools::destructor_destroy_range(leaf->keys.data(), leaf->keys.data() + leaf->count);
+			vector_tools::destructor_destroy_range(leaf->values.data(), leaf->values.data() + leaf->count);
+			delete leaf;
+		}
+		else
+		{
+			auto inner = static_cast<inner_node*>(node);
+			vector_tools::destructor_destroy_range(inner->keys.data(), inner->keys.data() + inner->count);
+			delete inner;
+		}
+	}
+
+	static void destroy_subtree(node_base *node) noexcept
+	{
+		if (!node->is_leaf)
+		{
+			auto inner = static_cast<inner_node*>(node);
+			for (size_type ix = 0; ix <= inner->count; ++ix)
+				destroy_subtree(inner->children[ix]);
+		}
+		destroy_node(node);
+	}
+
+	template<typename K, typename V>
+	static void push_entry(leaf_node &leaf, K &&key, V &&value)
+	{
+		::new(leaf.keys.data() + leaf.count) Key(std::forward<K>(key));
+		try
+		{
+			::new(leaf.values.data() + leaf.count) T(std::forward<V>(value));
+		}
+		catch (...)
+		{
+			leaf.keys[leaf.count].~Key();
+			throw;
+		}
+		++leaf.count;
+	}
+
+	//Returns the leaf where `key` belongs, splitting every full node on the way down to it,
+	//so that the leaf has room and any split below has room for its separator above.
+	leaf_node *leaf_for_insert(const Key &key)
+	{
+		if (!root_)
+		{
+			head_ = new leaf_node();
+			root_ = head_;
+			height_ = 1;
+		}
+
+		if (root_->count == Capacity)
+		{
+			auto root = new inner_node();
+			root->children[0] = root_;
+			try
+			{
+				split_child(*root, 0);
+			}
+			catch (...)
+			{
+				delete root;
+				throw;
+			}
+			root_ = root;
+			++height_;
+		}
+
+		auto curr = root_;
+		while (!curr->is_leaf)
+		{
+			auto inner = static_cast<inner_node*>(curr);
+			auto ix = upper_index(inner->keys.data(), inner->count, key);
+			if (inner->children[ix]->count == Capacity)
+			{
+				split_child(*inner, ix);
+				if (!comp_(key, inner->keys[ix]))
+					++ix;
+			}
+			curr = inner->children[ix];
+		}
+		return static_cast<leaf_node*>(curr);
+	}
+
+	//Splits the full child `ix` of `parent`, which has room for another key, in two.
+	//The only steps that can throw, copying a leaf's separator and allocating the new node, come first.
+	void split_child(inner_node &parent, size_type ix)
+	{
+		auto child = parent.children[ix];
+		auto mid = Capacity / 2;
+		if (child->is_leaf)
+		{
+			auto left = static_cast<leaf_node*>(child);
+			Key separator(left->keys[mid]);
+			auto right = new leaf_node();
+
+			relocate(right->keys.data(), left->keys.data() + mid, Capacity - mid);
+			relocate(right->values.data(), left->values.data() + mid, Capacity - mid);
+			right->count = Capacity - mid;
+			left->count = mid;
+			right->next = left->next;
+			left->next = right;
+
+			add_child(parent, ix, std::move(separator), right);
+		}
+		else
+		{
+			auto left = static_cast<inner_node*>(child);
+			auto right = new inner_node();
+
+			relocate(right->keys.data(), left->keys.data() + mid + 1, Capacity - mid - 1);
+			std::copy(left->children + mid + 1, left->children + Capacity + 1, right->children);
+			right->count = Capacity - mid - 1;
+
+			Key separator(std::move(left->keys[mid]));
+			left->keys[mid].~Key();
+			left->count = mid;
+
+			add_child(parent, ix, std::move(separator), right);
+		}
+	}
+
+	//Adds `separator` and the `right` child after child `ix` of `parent`.
+	static void add_child(inner_node &parent, size_type ix, Key &&separator, node_base *right) noexcept
+	{
+		insert_at(parent.keys.data(), parent.count, ix, std::move(separator));
+		std::copy_backward(parent.children + ix + 1, parent.children + parent.count + 1,
+			parent.children + parent.count + 2);
+		parent.children[ix + 1] = right;
+		++parent.count;
+	}
+
+	//Removes the key `ix` and the child after it from `parent`.
+	static void remove_child(inner_node &parent, size_type ix) noexcept
+	{
+		erase_at(parent.keys.data(), parent.count, ix);
+		std::copy(parent.children + ix + 2, parent.children + parent.count + 1, parent.children + ix + 1);
+		--parent.count;
+	}
+
+	//Gives child `ix` of `parent`, which has only its minimum of keys, at least one more,
+	//by borrowing from a sibling that can spare one or else merging with a sibling.
+	//Returns the index of the child that now covers child `ix`'s keys.
+	size_type refill_child(inner_node &parent, size_type ix)
+	{
+		if (ix > 0 && parent.children[ix - 1]->count > min_count(parent.children[ix - 1]))
+		{
+			borrow_from_left(parent, ix);
+			return ix;
+		}
+
+		if (ix < parent.count && parent.children[ix + 1]->count > min_count(parent.children[ix + 1]))
+		{
+			borrow_from_right(parent, ix);
+			return ix;
+		}
+
+		if (ix < parent.count)
+		{
+			merge_children(parent, ix);
+			return ix;
+		}
+
+		merge_children(parent, ix - 1);
+		return ix - 1;
+	}
+
+	void borrow_from_left(inner_node &parent, size_type ix)
+	{
+		auto child = parent.children[ix];
+		if (child->is_leaf)
+		{
+			auto left = static_cast<leaf_node*>(parent.children[ix - 1]);
+			auto right = static_cast<leaf_node*>(child);
+			auto last = left->count - 1;
+			Key separator(left->keys[last]);
+
+			insert_at(right->keys.data(), right->count, 0, std::move(left->keys[last]));
+			insert_at(right->values.data(), right->count, 0, std::move(left->values[last]));
+			++right->count;
+			erase_at(left->keys.data(), left->count, last);
+			erase_at(left->values.data(), left->count, last);
+			--left->count;
+			parent.keys[ix - 1] = std::move(separator);
+		}
+		else
+		{
+			auto left = static_cast<inner_node*>(parent.children[ix - 1]);
+			auto right = static_cast<inner_node*>(child);
+			auto last = left->count - 1;
+
+			insert_at(right->keys.data(), right->count, 0, std::move(parent.keys[ix - 1]));
+			std::copy_backward(right->children, right->children + right->count + 1, right->children + right->count + 2);
+			right->children[0] = left->children[left->count];
+			++right->count;
+			parent.keys[ix - 1] = std::move(left->keys[last]);
+			erase_at(left->keys.data(), left->count, last);
+			--left->count;
+		}
+	}
+
+	void borrow_from_right(inner_node &parent, size_type ix)
+	{
+		auto child = parent.children[ix];
+		if (child->is_leaf)
+		{
+			auto left = static_cast<leaf_node*>(child);
+			auto right = static_cast<leaf_node*>(parent.children[ix + 1]);
+			Key separator(right->keys[1]);
+
+			insert_at(left->keys.data(), left->count, left->count, std::move(right->keys[0]));
+			insert_at(left->values.data(), left->count, left->count, std::move(right->values[0]));
+			++left->count;
+			erase_at(right->keys.data(), right->count, 0);
+			erase_at(right->values.data(), right->count, 0);
+			--right->count;
+			parent.keys[ix] = std::move(separator);
+		}
+		else
+		{
+			auto left = static_cast<inner_node*>(child);
+			auto right = static_cast<inner_node*>(parent.children[ix + 1]);
+
+			insert_at(left->keys.data(), left->count, left->count, std::move(parent.keys[ix]));
+			left->children[left->count + 1] = right->children[0];
+			++left->count;
+			parent.keys[ix] = std::move(right->keys[0]);
+			erase_at(right->keys.data(), right->count, 0);
+			std::copy(right->children + 1, right->children + right->count + 1, right->children);
+			--right->count;
+		}
+	}
+
+	//Merges child `ix + 1` of `parent` into child `ix`. Together they fit in one node.
+	static void merge_children(inner_node &parent, size_type ix) noexcept
+	{
+		auto child = parent.children[ix];
+		if (child->is_leaf)
+		{
+			auto left = static_cast<leaf_node*>(child);
+			auto right = static_cast<leaf_node*>(parent.children[ix + 1]);
+
+			relocate(left->keys.data() + left->count, right->keys.data(), right->count);
+			relocate(left->values.data() + left->count, right->values.data(), right->count);
+			left->count += right->count;
+			left->next = right->next;
+			right->count = 0;
+			destroy_node(right);
+		}
+		else
+		{
+			auto left = static_cast<inner_node*>(child);
+			auto right = static_cast<inner_node*>(parent.children[ix + 1]);
+
+			insert_at(left->keys.data(), left->count, left->count, std::move(parent.keys[ix]));
+			relocate(left->keys.data() + left->count + 1, right->keys.data(), right->count);
+			std::copy(right->children, right->children + right->count + 1, left->children + left->count + 1);
+			left->count += right->count + 1;
+			right->count = 0;
+			destroy_node(right);
+		}
+
+		remove_child(parent, ix);
+	}
+
+	//Replaces a root left with no keys by its only child, or frees an empty root leaf.
+	void shrink_root() noexcept
+	{
+		while (!root_->is_leaf && root_->count == 0)
+		{
+			auto old = static_cast<inner_node*>(root_);
+			root_ = old->children[0];
+			destroy_node(old);
+			--height_;
+		}
+
+		if (root_->count == 0)
+			clear();
+	}
+
+	template<typename KeyIt, typename ValueIt>
+	void assign_sorted(const my_vector<Key> &keys, const my_vector<T> &values, KeyIt key_it, ValueIt value_it)
+	{
+		if (keys.size() != values.size())
+			throw std::invalid_argument("bplus_tree: different numbers of keys and values");
+
+		for (size_type ix = 1; ix < keys.size(); ++ix)
+		{
+			if (!comp_(keys[ix - 1], keys[ix]))
+				throw std::invalid_argument("bplus_tree: keys are not sorted and unique");
+		}
+
+		bplus_tree temp(comp_);
+		temp.build(keys.size(), [&](leaf_node &out, size_type count) {
+			for (; count != 0; --count, ++key_it, ++value_it)
+				push_entry(out, *key_it, *value_it);
+		});
+		swap(temp);
+	}
+
+	//Builds the tree, which must be empty, from `size` entries in key order.
+	//`fill(leaf, count)` appends the next `count` entries to `leaf`.
+	//Leaves are filled as evenly as possible, then each level of inner nodes is built over the one below,
+	//with each node's first key carried up as its separator, so every node but the root is at least half full.
+	template<typename Fill>
+	void build(size_type size, Fill fill)
+	{
+		if (size == 0)
+			return;
+
+		//Every node made is kept here until the tree is complete, to be freed should a copy throw.
+		my_vector<node_base*> made;
+		my_vector<node_base*> level;
+		my_vector<Key> first_keys;
+		try
+		{
+			auto leaves = (size + Capacity - 1) / Capacity;
+			made.reserve(leaves + leaves / 2 + 1);
+			level.reserve(leaves);
+			first_keys.reserve(leaves);
+
+			leaf_node *prev = nullptr;
+			for (size_type ix = 0; ix != leaves; ++ix)
+			{
+				made.push_back(nullptr);
+				auto leaf = new leaf_node();
+				made.back() = leaf;
+				fill(*leaf, size * (ix + 1) / leaves - size * ix / leaves);
+				(prev ? prev->next : head_) = leaf;
+				prev = leaf;
+				level.push_back(leaf);
+				first_keys.push_back(leaf->keys[0]);
+			}
+			height_ = 1;
+
+			while (level.size() > 1)
+			{
+				auto parents = (level.size() + Capacity) / (Capacity + 1);
+				size_type next = 0;
+				for (size_type ix = 0; ix != parents; ++ix)
+				{
+					made.push_back(nullptr);
+					auto parent = new inner_node();
+					made.back() = parent;
+
+					auto first = level.size() * ix / parents;
+					auto last = level.size() * (ix + 1) / parents;
+					parent->children[0] = level[first];
+					for (auto child = first + 1; child != last; ++child)
+					{
+						::new(parent->keys.data() + parent->count) Key(std::move(first_keys[child]));
+						parent->children[++parent->count] = level[child];
+					}
+
+					//Each parent's first key is its first child's, which was not used.
+					level[next] = parent;
+					if (next != first)
+						first_keys[next] = std::move(first_keys[first]);
+					++next;
+				}
+				level.erase(level.begin() + next, level.end());
+				++height_;
+			}
+		}
+		catch (...)
+		{
+			for (auto node : made)
+			{
+				if (node)
+					destroy_node(node);
+			}
+			head_ = nullptr;
+			height_ = 0;
+			throw;
+		}
+
+		root_ = level[0];
+		size_ = size;
+	}
+};
+
+template<typename Key, typename T, typename Compare, std::size_t Capacity>
+constexpr std::size_t bplus_tree<Key, T, Compare, Capacity>::min_leaf_count;
+
+template<typename Key, typename T, typename Compare, std::size_t Capacity>
+constexpr std::size_t bplus_tree<Key, T, Compare, Capacity>::min_inner_count;
+
+#endif //BPLUS_TREE_HEADER
@@ -0,0 +1,504 @@
+#ifndef COLUMNAR_TABLE_HEADER
+#define COLUMNAR_TABLE_HEADER
+
+#include "my_vector.hpp"
+#include "bit_ops.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+///A set of rows of a table, one bit per row.
+///Bits past the last row are always clear, so whole words can be counted and combined.
+class row_selection
+{
+public:
+	using size_type = std::size_t;
+
+	explicit row_selection(size_type rows = 0, bool selected = false)
+		: rows_(rows), words_((rows + 63) / 64, selected ? ~std::uint64_t(0) : 0)
+	{
+		clear_padding();
+	}
+
+	size_type rows() const noexcept { return rows_; }
+
+	///The number of selected rows.
+	size_type count() const noexcept
+	{
+		size_type total = 0;
+		for (auto word : words_)
+			total += vector_tools::popcount(word);
+		return total;
+	}
+
+	bool test(size_type row) const { return (words_[row / 64] >> (row % 64)) & 1; }
+
+	void set(size_type row, bool selected = true)
+	{
+		auto bit = std::uint64_t(1) << (row % 64);
+		if (selected)
+			words_[row / 64] |= bit;
+		else
+			words_[row / 64] &= ~bit;
+	}
+
+	///Keeps only the rows also selected by `other`, which must cover the same number of rows.
+	row_selection &operator&=(const row_selection &other)
+	{
+		check_rows(other);
+		for (size_type ix = 0; ix != words_.size(); ++ix)
+			words_[ix] &= other.words_[ix];
+		return *this;
+	}
+
+	///Adds the rows selected by `other`, which must cover the same number of rows.
+	row_selection &operator|=(const row_selection &other)
+	{
+		check_rows(other);
+		for (size_type ix = 0; ix != words_.size(); ++ix)
+			words_[ix] |= other.words_[ix];
+		return *this;
+	}
+
+	///Selects exactly the rows that were not selected.
+	row_selection &flip() noexcept
+	{
+		for (auto &word : words_)
+			word = ~word;
+		clear_padding();
+		return *this;
+	}
+
+	friend row_selection operator&(row_selection lhs, const row_selection &rhs) { return lhs &= rhs; }
+	friend row_selection operator|(row_selection lhs, const row_selection &rhs) { return lhs |= rhs; }
+	friend row_selection operator~(row_selection sel) { return sel.flip(); }
+
+	///Calls `func(row)` for each selected row, in order.
+	template<typename Func>
+	void for_each(Func &&func) const
+	{
+		for (size_type ix = 0; ix != words_.size(); ++ix)
+			vector_tools::for_each_set_bit(words_[ix], ix * 64, func);
+	}
+
+	///The selected rows as a selection vector of row numbers, in order.
+	my_vector<std::uint32_t> indices() const
+	{
+		my_vector<std::uint32_t> out;
+		out.reserve(count());
+		for_each([&out](size_type row) { out.push_back(std::uint32_t(row)); });
+		return out;
+	}
+
+	///Selects the rows listed in `indices`, out of `rows`.
+	static row_selection from_indices(const my_vector<std::uint32_t> &indices, size_type rows)
+	{
+		row_selection sel(rows);
+		for (auto row : indices)
+		{
+			if (row >= rows)
+				throw std::out_of_range("Out of range");
+			sel.set(row);
+		}
+		return sel;
+	}
+
+	///The bits, 64 rows to a word, lowest row in the lowest bit.
+	std::uint64_t *words() noexcept { return words_.data(); }
+	const std::uint64_t *words() const noexcept { return words_.data(); }
+	size_type word_count() const noexcept { return words_.size(); }
+
+private:
+	size_type rows_;
+	my_vector<std::uint64_t> words_;
+
+	void clear_padding() noexcept
+	{
+		if (rows_ % 64 != 0)
+			words_.back() &= (std::uint64_t(1) << (rows_ % 64)) - 1;
+	}
+
+	void check_rows(const row_selection &other) const
+	{
+		if (rows_ != other.rows_)
+			throw std::invalid_argument("row_selection: row counts differ");
+	}
+};
+
+///Predicates for `columnar_table::filter` and `where`.
+///Any callable taking a column value and returning bool works; these are written without
+///branches, so that the compiler can vectorize evaluating them over a column.
+///They take the column value as its own type, so comparing a `double` column to `3` compares as `double`.
+namespace column_pred
+{
+	template<typename T> auto eq(T value) { return [value](const auto &x) { return x == value; }; }
+	template<typename T> auto ne(T value) { return [value](const auto &x) { return x != value; }; }
+	template<typename T> auto lt(T value) { return [value](const auto &x) { return x < value; }; }
+	template<typename T> auto le(T value) { return [value](const auto &x) { return !(value < x); }; }
+	template<typename T> auto gt(T value) { return [value](const auto &x) { return value < x; }; }
+	template<typename T> auto ge(T value) { return [value](const auto &x) { return !(x < value); }; }
+
+	///True for values in `[lo, hi]`.
+	template<typename T>
+	auto between(T lo, T hi)
+	{
+		return [lo, hi](const auto &x) { return (!(x < lo)) & (!(hi < x)); };
+	}
+
+	///True for values equal to any of a list.
+	///Short lists are compared against in full for every value; long ones are sorted and binary searched.
+	template<typename T>
+	class in_list
+	{
+	public:
+		explicit in_list(my_vector<T> values) : values_(std::move(values))
+		{
+			std::sort(values_.begin(), values_.end());
+		}
+
+		template<typename U>
+		bool operator()(const U &x) const
+		{
+			if (values_.size() > linear_limit)
+				return std::binary_search(values_.begin(), values_.end(), x);
+
+			bool found = false;
+			for (auto &value : values_)
+				found |= (x == value);
+			return found;
+		}
+
+	private:
+		static constexpr std::size_t linear_limit = 16;
+
+		my_vector<T> values_;
+	};
+
+	template<typename T>
+	constexpr std::size_t in_list<T>::linear_limit;
+
+	template<typename T>
+	in_list<T> in(my_vector<T> values) { return in_list<T>(std::move(values)); }
+}
+
+///A predicate on column `I` of a `columnar_table`, for `select_all` and `select_any`.
+template<std::size_t I, typename Pred>
+struct column_term
+{
+	Pred pred;
+};
+
+template<std::size_t I, typename Pred>
+column_term<I, Pred> where(Pred pred) { return column_term<I, Pred>{ std::move(pred) }; }
+
+namespace detail
+{
+	struct assign_bits { std::uint64_t operator()(std::uint64_t, std::uint64_t bits) const noexcept { return bits; } };
+	struct and_bits { std::uint64_t operator()(std::uint64_t old, std::uint64_t bits) const noexcept { return old & bits; } };
+	struct or_bits { std::uint64_t operator()(std::uint64_t old, std::uint64_t bits) const noexcept { return old | bits; } };
+
+	//Evaluates `pred` over rows `[first, last)`, `first` being a multiple of 64,
+	//and merges each 64 rows' results into their word with `combine`.
+	template<typename T, typename Pred, typename Combine>
+	void evaluate_rows(const T *values, std::size_t first, std::size_t last, const Pred &pred,
+		std::uint64_t *words, Combine combine)
+	{
+		for (auto row = first; row < last; row += 64)
+		{
+			auto count = std::min<std::size_t>(64, last - row);
+			auto block = values + row;
+			std::uint64_t bits = 0;
+			for (std::size_t ix = 0; ix != count; ++ix)
+				bits |= std::uint64_t(pred(block[ix]) ? 1 : 0) << ix;
+
+			words[row / 64] = combine(words[row / 64], bits);
+		}
+	}
+
+	inline bool any_bits(const std::uint64_t *words, std::size_t first, std::size_t last) noexcept
+	{
+		std::uint64_t any = 0;
+		for (auto ix = first / 64; ix != (last + 63) / 64; ++ix)
+			any |= words[ix];
+		return any != 0;
+	}
+
+	//Calls `func(first, last)` over `rows` in chunks of `chunk_rows`, split into contiguous runs of
+	//chunks across up to `thread_count` threads (0 for one per hardware thread).
+	//Rethrows the first exception thrown by any thread, once all of them have finished.
+	template<typename Func>
+	void for_each_row_chunk(std::size_t rows, std::size_t chunk_rows, unsigned thread_count, const Func &func)
+	{
+		auto chunks = (rows + chunk_rows - 1) / chunk_rows;
+		auto run = [&](std::size_t first_chunk, std::size_t last_chunk) {
+			for (auto chunk = first_chunk; chunk != last_chunk; ++chunk)
+				func(chunk * chunk_rows, std::min(rows, (chunk + 1) * chunk_rows));
+		};
+
+		if (thread_count == 0)
+			thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+		auto count = std::max<std::size_t>(1, std::min<std::size_t>(thread_count, chunks));
+		if (count == 1)
+		{
+			run(0, chunks);
+			return;
+		}
+
+		my_vector<std::exception_ptr> errors(count);
+		my_vector<std::thread> workers;
+		workers.reserve(count - 1);
+
+		auto run_part = [&](std::size_t part) {
+			try { run(chunks * part / count, chunks * (part + 1) / count); }
+			catch (...) { errors[part] = std::current_exception(); }
+		};
+
+		try
+		{
+			for (std::size_t part = 1; part < count; ++part)
+				workers.emplace_back(run_part, part);
+		}
+		catch (...)
+		{
+			for (auto &worker : workers)
+				worker.join();
+			throw;
+		}
+
+		run_part(0);
+		for (auto &worker : workers)
+			worker.join();
+
+		for (auto &error : errors)
+		{
+			if (error)
+				std::rethrow_exception(error);
+		}
+	}
+}
+
+///A table stored as one `my_vector` per column, all the same length.
+///Queries evaluate predicates a cache-sized chunk of rows at a time into a `row_selection` bitmap,
+///then gather the selected rows into new columns. Conjunctions and disjunctions of several predicates
+///are evaluated chunk by chunk, so each chunk's bits stay in cache while every predicate is applied,
+///and predicates after the first are skipped for chunks where they cannot change the result.
+///Scans can be split across threads; each thread takes a contiguous run of chunks.
+///Row numbers in selection vectors are 32-bit.
+template<typename ...Ts>
+class columnar_table
+{
+public:
+	using size_type = std::size_t;
+
+	template<std::size_t I>
+	using column_type = typename std::tuple_element<I, std::tuple<Ts...>>::type;
+
+	///Rows per chunk: a multiple of 64, so that chunks never share a selection word,
+	///and few enough that a chunk of an 8-byte column fits in a typical L2 cache.
+	static constexpr size_type chunk_rows = 16384;
+
+	columnar_table() = default;
+
+	///Takes the given columns, which must all be the same length.
+	explicit columnar_table(my_vector<Ts> ...columns)
+		: columns_(std::move(columns)...)
+	{
+		check_lengths(std::index_sequence_for<Ts...>{});
+	}
+
+	size_type rows() const noexcept { return std::get<0>(columns_).size(); }
+	static constexpr size_type column_count() noexcept { return sizeof...(Ts); }
+
+	template<std::size_t I>
+	const my_vector<column_type<I>> &column() const noexcept { return std::get<I>(columns_); }
+
+	void reserve(size_type rows)
+	{
+		for_each_column([rows](auto &col) { col.reserve(rows); });
+	}
+
+	void append_row(const Ts &...values)
+	{
+		append_row(std::index_sequence_for<Ts...>{}, values...);
+	}
+
+	///Selects the rows whose value in column `I` satisfies `pred`.
+	template<std::size_t I, typename Pred>
+	row_selection filter(const Pred &pred, unsigned thread_count = 1) const
+	{
+		return select_all_parallel(thread_count, where<I>(pred));
+	}
+
+	///Selects the rows that satisfy every term, on the calling thread.
+	template<typename ...Terms>
+	row_selection select_all(const Terms &...terms) const
+	{
+		return select_all_parallel(1, terms...);
+	}
+
+	///Selects the rows that satisfy any term, on the calling thread.
+	template<typename ...Terms>
+	row_selection select_any(const Terms &...terms) const
+	{
+		return select_any_parallel(1, terms...);
+	}
+
+	///As `select_all`, with the chunks split across up to `thread_count` threads.
+	template<typename ...Terms>
+	row_selection select_all_parallel(unsigned thread_count, const Terms &...terms) const
+	{
+		static_assert(sizeof...(Terms) != 0, "At least one term is needed.");
+
+		row_selection sel(rows());
+		auto words = sel.words();
+		detail::for_each_row_chunk(rows(), chunk_rows, thread_count, [&](size_type first, size_type last) {
+			apply_terms<detail::and_bits>(first, last, words, detail::assign_bits(), terms...);
+		});
+		return sel;
+	}
+
+	///As `select_any`, with the chunks split across up to `thread_count` threads.
+	template<typename ...Terms>
+	row_selection select_any_parallel(unsigned thread_count, const Terms &...terms) const
+	{
+		static_assert(sizeof...(Terms) != 0, "At least one term is needed.");
+
+		row_selection sel(rows());
+		auto words = sel.words();
+		detail::for_each_row_chunk(rows(), chunk_rows, thread_count, [&](size_type first, size_type last) {
+			apply_terms<detail::or_bits>(first, last, words, detail::assign_bits(), terms...);
+		});
+		return sel;
+	}
+
+	///Copies the selected rows into a new table.
+	columnar_table gather(const row_selection &sel) const
+	{
+		if (sel.rows() != rows())
+			throw std::invalid_argument("columnar_table: selection is for a different table");
+
+		auto count = sel.count();
+		columnar_table out;
+		out.for_each_column([count](auto &col) { col.reserve(count); });
+		gather_columns(out, [&sel](auto &from, auto &to) {
+			sel.for_each([&](size_type row) { to.push_back(from[row]); });
+		}, std::index_sequence_for<Ts...>{});
+		return out;
+	}
+
+	///Copies the rows listed in `indices`, in that order, into a new table.
+	columnar_table gather(const my_vector<std::uint32_t> &indices) const
+	{
+		for (auto row : indices)
+		{
+			if (row >= rows())
+				throw std::out_of_range("Out of range");
+		}
+
+		columnar_table out;
+		out.for_each_column([&indices](auto &col) { col.reserve(indices.size()); });
+		gather_columns(out, [&indices](auto &from, auto &to) {
+			for (auto row : indices)
+				to.push_back(from[row]);
+		}, std::index_sequence_for<Ts...>{});
+		return out;
+	}
+
+	///Copies the values of column `I` in the selected rows.
+	template<std::size_t I>
+	my_vector<column_type<I>> gather_column(const row_selection &sel) const
+	{
+		auto &from = column<I>();
+		my_vector<column_type<I>> out;
+		out.reserve(sel.count());
+		sel.for_each([&](size_type row) { out.push_back(from[row]); });
+		return out;
+	}
+
+private:
+	std::tuple<my_vector<Ts>...> columns_;
+
+	template<std::size_t ...Is>
+	void check_lengths(std::index_sequence<Is...>) const
+	{
+		bool equal[] = { (std::get<Is>(columns_).size() == rows())... };
+		for (auto same : equal)
+		{
+			if (!same)
+				throw std::invalid_argument("columnar_table: columns differ in length");
+		}
+	}
+
+	template<std::size_t ...Is>
+	void append_row(std::index_sequence<Is...>, const Ts &...values)
+	{
+		int expand[] = { (std::get<Is>(columns_).push_back(values), 0)... };
+		(void)expand;
+	}
+
+	template<typename Func>
+	void for_each_column(Func func)
+	{
+		for_each_column(func, std::index_sequence_for<Ts...>{});
+	}
+
+	template<typename Func, std::size_t ...Is>
+	void for_each_column(Func &func, std::index_sequence<Is...>)
+	{
+		int expand[] = { (func(std::get<Is>(columns_)), 0)... };
+		(void)expand;
+	}
+
+	template<typename Func, std::size_t ...Is>
+	void gather_columns(columnar_table &out, Func func, std::index_sequence<Is...>) const
+	{
+		int expand[] = { (func(std::get<Is>(columns_), std::get<Is>(out.columns_)), 0)... };
+		(void)expand;
+	}
+
+	//Applies the first term to the chunk `[first, last)` with `combine`, and the rest with `Rest`.
+	//A conjunction stops once the chunk has no rows left; a disjunction once it has all of them.
+	template<typename Rest, typename Combine>
+	void apply_terms(size_type, size_type, std::uint64_t*, Combine) const {}
+
+	template<typename Rest, typename Combine, std::size_t I, typename Pred, typename ...Terms>
+	void apply_terms(size_type first, size_type last, std::uint64_t *words, Combine combine,
+		const column_term<I, Pred> &term, const Terms &...terms) const
+	{
+		detail::evaluate_rows(std::get<I>(columns_).data(), first, last, term.pred, words, combine);
+
+		if (sizeof...(Terms) == 0 || !worth_continuing(first, last, words, Rest()))
+			return;
+
+		apply_terms<Rest>(first, last, words, Rest(), terms...);
+	}
+
+	bool worth_continuing(size_type first, size_type last, const std::uint64_t *words, detail::and_bits) const noexcept
+	{
+		return detail::any_bits(words, first, last);
+	}
+
+	bool worth_continuing(size_type first, size_type last, const std::uint64_t *words, detail::or_bits) const noexcept
+	{
+		std::uint64_t all = ~std::uint64_t(0);
+		for (auto ix = first / 64; ix != last / 64; ++ix)
+			all &= words[ix];
+
+		//The last chunk may end partway through a word, whose bits past the end are clear.
+		if (last % 64 != 0)
+			all &= words[last / 64] | ~((std::uint64_t(1) << (last % 64)) - 1);
+		return all != ~std::uint64_t(0);
+	}
+};
+
+template<typename ...Ts>
+constexpr typename columnar_table<Ts...>::size_type columnar_table<Ts...>::chunk_rows;
+
+#endif //COLUMNAR_TABLE_HEADER
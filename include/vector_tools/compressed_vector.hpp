@@ -0,0 +1,442 @@
+#ifndef COMPRESSED_VECTOR_HEADER
+#define COMPRESSED_VECTOR_HEADER
+
+#include "my_vector.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <future>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace detail
+{
+	//A small LZ77 codec for the byte-shuffled chunks of `compressed_vector`.
+	//The stream is a sequence of tokens. A control byte below 128 is followed by that many
+	//plus one literal bytes; any other is a match of `control - 124` bytes (4 to 131),
+	//copied from a 16-bit little-endian distance back in the output.
+	namespace lz
+	{
+		constexpr std::size_t min_match = 4;
+		constexpr std::size_t max_match = 131;
+		constexpr std::size_t max_literals = 128;
+		constexpr std::size_t max_distance = 65535;
+		constexpr unsigned hash_bits = 12;
+
+		inline void put_literals(const unsigned char *first, std::size_t count, my_vector<unsigned char> &out)
+		{
+			while (count != 0)
+			{
+				auto run = count < max_literals ? count : max_literals;
+				out.push_back((unsigned char)(run - 1));
+				out.insert(out.end(), first, first + run);
+				first += run;
+				count -= run;
+			}
+		}
+
+		///Appends the compressed form of `in[0, size)` to `out`.
+		///`table` is scratch space, kept by the caller so that it is only allocated once.
+		inline void compress(const unsigned char *in, std::size_t size, my_vector<unsigned char> &out,
+			my_vector<std::uint32_t> &table)
+		{
+			//Positions are stored plus one, so that 0 marks an empty entry.
+			table.resize(std::size_t(1) << hash_bits);
+			for (auto &entry : table)
+				entry = 0;
+
+			std::size_t literal_start = 0;
+			std::size_t pos = 0;
+			while (pos + min_match <= size)
+			{
+				std::uint32_t seq;
+				std::memcpy(&seq, in + pos, sizeof(seq));
+				auto &entry = table[(seq * 2654435761u) >> (32 - hash_bits)];
+				auto candidate = std::size_t(entry);
+				entry = std::uint32_t(pos + 1);
+
+				if (candidate == 0 || pos - (candidate - 1) > max_distance ||
+					std::memcmp(in + candidate - 1, in + pos, min_match) != 0)
+				{
+					++pos;
+					continue;
+				}
+
+				auto match = candidate - 1;
+				auto length = min_match;
+				while (pos + length < size && length < max_match && in[match + length] == in[pos + length])
+					++length;
+
+				put_literals(in + literal_start, pos - literal_start, out);
+				auto distance = pos - match;
+				out.push_back((unsigned char)(length + (max_literals - min_match)));
+				out.push_back((unsigned char)(distance & 0xFF));
+				out.push_back((unsigned char)(distance >> 8));
+
+				pos += length;
+				literal_start = pos;
+			}
+
+			put_literals(in + literal_start, size - literal_start, out);
+		}
+
+		///Decompresses `in[0, size)` into exactly `out_size` bytes at `out`.
+		///Throws `std::runtime_error` if the stream is malformed.
+		inline void decompress(const unsigned char *in, std::size_t size, unsigned char *out, std::size_t out_size)
+		{
+			std::size_t in_pos = 0;
+			std::size_t out_pos = 0;
+			while (in_pos != size)
+			{
+				std::size_t control = in[in_pos++];
+				if (control < max_literals)
+				{
+					auto run = control + 1;
+					if (run > size - in_pos || run > out_size - out_pos)
+						throw std::runtime_error("lz: corrupt stream");
+
+					std::memcpy(out + out_pos, in + in_pos, run);
+					in_pos += run;
+					out_pos += run;
+				}
+				else
+				{
+					auto length = control - (max_literals - min_match);
+					if (size - in_pos < 2)
+						throw std::runtime_error("lz: corrupt stream");
+
+					auto distance = std::size_t(in[in_pos]) | (std::size_t(in[in_pos + 1]) << 8);
+					in_pos += 2;
+					if (distance == 0 || distance > out_pos || length > out_size - out_pos)
+						throw std::runtime_error("lz: corrupt stream");
+
+					//Byte by byte, since a match may overlap the bytes it produces.
+					for (auto end = out_pos + length; out_pos != end; ++out_pos)
+						out[out_pos] = out[out_pos - distance];
+				}
+			}
+
+			if (out_pos != out_size)
+				throw std::runtime_error("lz: corrupt stream");
+		}
+	}
+}
+
+///An append-only sequence of trivially copyable values, held compressed in fixed-size chunks.
+///Values are appended to an uncompressed tail; once it holds `chunk_size` of them it is sealed:
+///each value is replaced by its difference from the one before (or, for non-integers, a bytewise XOR),
+///the bytes are shuffled so that all the first bytes come first, then all the second bytes and so on,
+///and the result is LZ-compressed. Slowly changing or clustered data shuffles into long runs of
+///equal bytes, which compress several times over.
+///Random access decompresses at most one chunk, into a small cache of recently used chunks.
+///Sequential scans decompress chunks on a helper thread, ahead of the ones being visited.
+///Not thread-safe, even for reads, since reads fill the cache.
+template<typename T>
+class compressed_vector
+{
+public:
+	static_assert(std::is_trivially_copyable<T>::value, "Values must be trivially copyable.");
+
+	using value_type = T;
+	using size_type = std::size_t;
+
+	///Creates an empty vector that seals every `chunk_size` values, and caches up to `cache_chunks` of them.
+	explicit compressed_vector(size_type chunk_size = 4096, size_type cache_chunks = 4)
+		: chunk_size_(chunk_size), cache_(cache_chunks)
+	{
+		if (chunk_size == 0 || cache_chunks == 0)
+			throw std::length_error("compressed_vector: chunk size and cache size must be positive");
+
+		tail_.reserve(chunk_size);
+	}
+
+	compressed_vector(compressed_vector &&) = default;
+	compressed_vector &operator=(compressed_vector &&) = default;
+	compressed_vector(const compressed_vector &) = delete;
+	compressed_vector &operator=(const compressed_vector &) = delete;
+
+	size_type size() const noexcept { return chunks_.size() * chunk_size_ + tail_.size(); }
+	bool empty() const noexcept { return size() == 0; }
+	size_type chunk_size() const noexcept { return chunk_size_; }
+
+	///The number of sealed, compressed chunks.
+	size_type sealed_chunks() const noexcept { return chunks_.size(); }
+
+	///The bytes taken by the sealed chunks.
+	size_type compressed_bytes() const noexcept
+	{
+		size_type bytes = 0;
+		for (auto &chunk : chunks_)
+			bytes += chunk.capacity();
+		return bytes;
+	}
+
+	///The bytes the sealed chunks would take uncompressed.
+	size_type uncompressed_bytes() const noexcept { return chunks_.size() * chunk_size_ * sizeof(T); }
+
+	///All the bytes owned by the vector: sealed chunks, the tail, the cache and scratch space.
+	size_type memory_bytes() const noexcept
+	{
+		auto bytes = compressed_bytes() + chunks_.capacity() * sizeof(my_vector<unsigned char>) +
+			tail_.capacity() * sizeof(T) + shuffled_.capacity() + table_.capacity() * sizeof(std::uint32_t) +
+			decoded_.capacity();
+		for (auto &entry : cache_)
+			bytes += sizeof(entry) + entry.values.capacity() * sizeof(T);
+		return bytes;
+	}
+
+	void push_back(const T &value)
+	{
+		tail_.push_back(value);
+		if (tail_.size() == chunk_size_)
+			seal_tail();
+	}
+
+	///Appends the `count` values at `first`.
+	void append(const T *first, size_type count)
+	{
+		while (count != 0)
+		{
+			auto room = chunk_size_ - tail_.size();
+			auto run = count < room ? count : room;
+			tail_.insert(tail_.end(), first, first + run);
+			first += run;
+			count -= run;
+			if (tail_.size() == chunk_size_)
+				seal_tail();
+		}
+	}
+
+	///The value at `ix`, decompressing its chunk if it is not cached.
+	T operator[](size_type ix) const
+	{
+		auto chunk = ix / chunk_size_;
+		if (chunk == chunks_.size())
+			return tail_[ix % chunk_size_];
+
+		return cached_chunk(chunk)[ix % chunk_size_];
+	}
+
+	T at(size_type ix) const
+	{
+		if (ix < size())
+			return (*this)[ix];
+		throw std::out_of_range("Out of range");
+	}
+
+	///Calls `func(data, count)` with the values of each chunk in order, the tail last.
+	///Sealed chunks are decompressed in groups on a helper thread, one group ahead of `func`.
+	///The cache is neither used nor disturbed.
+	template<typename Func>
+	void for_each_chunk(Func func) const
+	{
+		auto group_count = (chunks_.size() + pipeline_group - 1) / pipeline_group;
+		if (group_count != 0)
+		{
+			my_vector<T> current(pipeline_group * chunk_size_);
+			my_vector<T> next(pipeline_group * chunk_size_);
+			auto decode = [this](size_type group, my_vector<T> *out) {
+				my_vector<unsigned char> scratch;
+				auto first = group * pipeline_group;
+				auto last = std::min(chunks_.size(), first + pipeline_group);
+				for (auto chunk = first; chunk != last; ++chunk)
+					decode_chunk(chunk, out->data() + (chunk - first) * chunk_size_, scratch);
+			};
+
+			decode(0, &current);
+			for (size_type group = 0; group != group_count; ++group)
+			{
+				std::future<void> ahead;
+				if (group + 1 != group_count)
+					ahead = std::async(std::launch::async, decode, group + 1, &next);
+
+				auto first = group * pipeline_group;
+				auto last = std::min(chunks_.size(), first + pipeline_group);
+				for (auto chunk = first; chunk != last; ++chunk)
+					func(static_cast<const T*>(current.data() + (chunk - first) * chunk_size_), chunk_size_);
+
+				if (ahead.valid())
+					ahead.get();
+				current.swap(next);
+			}
+		}
+
+		if (!tail_.empty())
+			func(static_cast<const T*>(tail_.data()), tail_.size());
+	}
+
+	///Calls `func(value)` for every value in order, decompressing as `for_each_chunk` does.
+	template<typename Func>
+	void for_each(Func func) const
+	{
+		for_each_chunk([&func](const T *data, size_type count) {
+			for (size_type ix = 0; ix != count; ++ix)
+				func(data[ix]);
+		});
+	}
+
+	///Decompresses everything into a new vector.
+	my_vector<T> to_vector() const
+	{
+		my_vector<T> out;
+		out.reserve(size());
+		for_each_chunk([&out](const T *data, size_type count) {
+			out.insert(out.end(), data, data + count);
+		});
+		return out;
+	}
+
+	void clear() noexcept
+	{
+		chunks_.clear();
+		tail_.clear();
+		for (auto &entry : cache_)
+			entry.chunk = npos;
+	}
+
+private:
+	static constexpr size_type npos = std::numeric_limits<size_type>::max();
+
+	//Chunks decompressed per helper-thread task during scans.
+	static constexpr size_type pipeline_group = 8;
+
+	//Integers are delta-encoded by subtraction, which turns a steady rise into repeated small values.
+	//Anything else is XORed bytewise with its predecessor, which zeroes the bytes that did not change.
+	using delta_by_subtraction = std::integral_constant<bool,
+		std::is_integral<T>::value && !std::is_same<T, bool>::value>;
+
+	struct cache_entry
+	{
+		size_type chunk = npos;
+		size_type last_used = 0;
+		my_vector<T> values;
+	};
+
+	size_type chunk_size_;
+	my_vector<my_vector<unsigned char>> chunks_;
+	my_vector<T> tail_;
+	//Scratch space for sealing.
+	my_vector<unsigned char> shuffled_;
+	my_vector<std::uint32_t> table_;
+	mutable my_vector<cache_entry> cache_;
+	mutable my_vector<unsigned char> decoded_;
+	mutable size_type clock_ = 0;
+
+	template<typename U>
+	static void delta_encode(const U *in, unsigned char *out, std::true_type) noexcept
+	{
+		using unsigned_type = std::make_unsigned_t<U>;
+		auto delta = unsigned_type(unsigned_type(in[0]) - unsigned_type(in[-1]));
+		std::memcpy(out, &delta, sizeof(U));
+	}
+
+	template<typename U>
+	static void delta_encode(const U *in, unsigned char *out, std::false_type) noexcept
+	{
+		auto curr = reinterpret_cast<const unsigned char*>(in);
+		auto prev = reinterpret_cast<const unsigned char*>(in - 1);
+		for (size_type byte = 0; byte != sizeof(U); ++byte)
+			out[byte] = curr[byte] ^ prev[byte];
+	}
+
+	template<typename U>
+	static void delta_decode(U *out, const unsigned char *delta, std::true_type) noexcept
+	{
+		using unsigned_type = std::make_unsigned_t<U>;
+		unsigned_type diff;
+		std::memcpy(&diff, delta, sizeof(U));
+		out[0] = U(unsigned_type(unsigned_type(out[-1]) + diff));
+	}
+
+	template<typename U>
+	static void delta_decode(U *out, const unsigned char *delta, std::false_type) noexcept
+	{
+		auto curr = reinterpret_cast<unsigned char*>(out);
+		auto prev = reinterpret_cast<const unsigned char*>(out - 1);
+		for (size_type byte = 0; byte != sizeof(U); ++byte)
+			curr[byte] = delta[byte] ^ prev[byte];
+	}
+
+	void seal_tail()
+	{
+		auto count = tail_.size();
+		shuffled_.resize_default_init(count * sizeof(T));
+
+		//The first value is stored whole; the rest as deltas from their predecessors.
+		unsigned char delta[sizeof(T)];
+		for (size_type ix = 0; ix != count; ++ix)
+		{
+			if (ix == 0)
+				std::memcpy(delta, tail_.data(), sizeof(T));
+			else
+				delta_encode(tail_.data() + ix, delta, delta_by_subtraction{});
+
+			for (size_type byte = 0; byte != sizeof(T); ++byte)
+				shuffled_[byte * count + ix] = delta[byte];
+		}
+
+		my_vector<unsigned char> packed;
+		packed.reserve(count * sizeof(T) / 4 + 16);
+		detail::lz::compress(shuffled_.data(), shuffled_.size(), packed, table_);
+		packed.shrink_to_fit();
+
+		chunks_.push_back(std::move(packed));
+		tail_.clear();
+	}
+
+	//Decompresses sealed chunk `chunk` into the `chunk_size_` values at `out`.
+	void decode_chunk(size_type chunk, T *out, my_vector<unsigned char> &scratch) const
+	{
+		auto &packed = chunks_[chunk];
+		scratch.resize_default_init(chunk_size_ * sizeof(T));
+		detail::lz::decompress(packed.data(), packed.size(), scratch.data(), scratch.size());
+
+		unsigned char delta[sizeof(T)];
+		for (size_type ix = 0; ix != chunk_size_; ++ix)
+		{
+			for (size_type byte = 0; byte != sizeof(T); ++byte)
+				delta[byte] = scratch[byte * chunk_size_ + ix];
+
+			if (ix == 0)
+				std::memcpy(out, delta, sizeof(T));
+			else
+				delta_decode(out + ix, delta, delta_by_subtraction{});
+		}
+	}
+
+	//Returns the values of sealed chunk `chunk`, decompressing it over the least recently used
+	//cache entry if it is not cached.
+	const my_vector<T> &cached_chunk(size_type chunk) const
+	{
+		auto victim = cache_.begin();
+		for (auto entry = cache_.begin(); entry != cache_.end(); ++entry)
+		{
+			if (entry->chunk == chunk)
+			{
+				entry->last_used = ++clock_;
+				return entry->values;
+			}
+			if (entry->last_used < victim->last_used)
+				victim = entry;
+		}
+
+		//Mark the entry empty first, in case decompression throws.
+		victim->chunk = npos;
+		victim->values.resize_default_init(chunk_size_);
+		decode_chunk(chunk, victim->values.data(), decoded_);
+		victim->chunk = chunk;
+		victim->last_used = ++clock_;
+		return victim->values;
+	}
+};
+
+template<typename T>
+constexpr typename compressed_vector<T>::size_type compressed_vector<T>::npos;
+
+template<typename T>
+constexpr typename compressed_vector<T>::size_type compressed_vector<T>::pipeline_group;
+
+#endif //COMPRESSED_VECTOR_HEADER
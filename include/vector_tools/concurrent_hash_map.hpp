@@ -0,0 +1,361 @@
+#ifndef CONCURRENT_HASH_MAP_HEADER
+#define CONCURRENT_HASH_MAP_HEADER
+
+#include "my_vector.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <type_traits>
+
+///A concurrent open-addressing hash map for small, trivially copyable keys and values.
+///Each slot holds a state word, the key and the value in separate atomics.
+///Lookups never block and never write shared memory. Inserts and updates claim slots
+///with a compare-exchange, and only ever wait for another writer that is mid-way
+///through filling or migrating the very slot they need.
+///When the table grows past half full, a table twice the size is linked after it, and
+///every writer helps migrate one chunk of slots before doing its own work.
+///Old tables stay allocated until the map is destroyed, as readers may still be in them;
+///together they never take more memory than the current table.
+///Keys are compared bitwise. Elements cannot be erased.
+template<typename K, typename V, typename Hash = std::hash<K>>
+class concurrent_hash_map
+{
+public:
+	static_assert(std::is_trivially_copyable<K>::value && std::is_trivially_copyable<V>::value,
+		"Keys and values must be trivially copyable.");
+	static_assert(sizeof(K) <= sizeof(std::uint64_t) && sizeof(V) <= sizeof(std::uint64_t),
+		"Keys and values must fit in 64 bits.");
+
+	using key_type = K;
+	using mapped_type = V;
+	using size_type = std::size_t;
+
+	explicit concurrent_hash_map(size_type initial_capacity = 1024, const Hash &hash = Hash())
+		: hash_(hash), size_(0)
+	{
+		size_type rounded = 16;
+		while (rounded < initial_capacity)
+			rounded *= 2;
+
+		oldest_ = new table(rounded);
+		root_.store(oldest_, std::memory_order_relaxed);
+	}
+
+	concurrent_hash_map(const concurrent_hash_map &) = delete;
+	concurrent_hash_map &operator=(const concurrent_hash_map &) = delete;
+
+	~concurrent_hash_map()
+	{
+		auto curr = oldest_;
+		while (curr)
+		{
+			auto next = curr->next.load(std::memory_order_relaxed);
+			delete curr;
+			curr = next;
+		}
+	}
+
+	///The number of keys inserted. Only a snapshot while other threads are active.
+	size_type size() const noexcept { return size_.load(std::memory_order_relaxed); }
+
+	///The slot count of the current table.
+	size_type capacity() const noexcept { return root_.load(std::memory_order_acquire)->capacity(); }
+
+	///Copies the value for `key` into `out`, returning false if there is none.
+	///Never blocks.
+	bool find(const K &key, V &out) const noexcept
+	{
+		auto key_bits = to_bits(key);
+		auto hash = hash_(key);
+		auto curr = root_.load(std::memory_order_acquire);
+		while (true)
+		{
+			std::uint64_t value_bits;
+			switch (find_in(*curr, key_bits, hash, value_bits))
+			{
+			case lookup::found:
+				std::memcpy(&out, &value_bits, sizeof(V));
+				return true;
+			case lookup::absent:
+				return false;
+			case lookup::next:
+				curr = curr->next.load(std::memory_order_acquire);
+				break;
+			}
+		}
+	}
+
+	bool contains(const K &key) const noexcept
+	{
+		V value;
+		return find(key, value);
+	}
+
+	///Inserts `key` with `value` if it is not present.
+	///Returns false, leaving the existing value alone, if it was.
+	bool insert(const K &key, const V &value)
+	{
+		return write(key, value, false);
+	}
+
+	///Inserts `key` with `value`, or overwrites its value if it is present.
+	///Returns true if the key was newly inserted.
+	bool insert_or_assign(const K &key, const V &value)
+	{
+		return write(key, value, true);
+	}
+
+private:
+	enum slot_state : std::uint32_t
+	{
+		empty = 0,
+		//A writer owns the slot and is filling in the key and value.
+		claimed,
+		ready,
+		//A migrator is copying the slot into the next table. The value can still be read.
+		freezing,
+		//The slot's element lives in the next table.
+		moved_full,
+		//The slot was empty when migrated. Probes for any key continue in the next table.
+		moved_empty,
+	};
+
+	enum class lookup { found, absent, next };
+
+	struct slot
+	{
+		std::atomic<std::uint32_t> state;
+		std::atomic<std::uint64_t> key;
+		std::atomic<std::uint64_t> value;
+	};
+
+	//Slots are migrated in chunks of this many, each claimed by a single helper.
+	static constexpr size_type migrate_chunk = 1024;
+
+	struct table
+	{
+		explicit table(size_type capacity)
+			: slots(capacity), next(nullptr), count(0), next_chunk(0), chunks_done(0)
+		{}
+
+		size_type capacity() const noexcept { return slots.size(); }
+		size_type mask() const noexcept { return slots.size() - 1; }
+		size_type chunk_count() const noexcept { return (slots.size() + migrate_chunk - 1) / migrate_chunk; }
+
+		//Value-initialized, so every slot starts out `empty`.
+		my_vector<slot> slots;
+		std::atomic<table*> next;
+		//Slots claimed in this table, including those filled by migration.
+		std::atomic<size_type> count;
+		std::atomic<size_type> next_chunk;
+		std::atomic<size_type> chunks_done;
+	};
+
+	Hash hash_;
+	std::atomic<table*> root_;
+	table *oldest_;
+	std::atomic<size_type> size_;
+
+	template<typename U>
+	static std::uint64_t to_bits(const U &value) noexcept
+	{
+		std::uint64_t bits = 0;
+		std::memcpy(&bits, &value, sizeof(U));
+		return bits;
+	}
+
+	static std::uint32_t wait_while(const slot &target, std::uint32_t state) noexcept
+	{
+		std::uint32_t curr;
+		while ((curr = target.state.load(std::memory_order_acquire)) == state)
+			;
+		return curr;
+	}
+
+	lookup find_in(const table &tab, std::uint64_t key_bits, size_type hash, std::uint64_t &value_bits) const noexcept
+	{
+		auto mask = tab.mask();
+		for (size_type probe = 0; probe <= mask; ++probe)
+		{
+			auto &target = tab.slots[(hash + probe) & mask];
+			switch (target.state.load(std::memory_order_acquire))
+			{
+			case empty:
+				return lookup::absent;
+			case claimed:
+				//Not inserted yet, as far as readers are concerned.
+				break;
+			case ready:
+			case freezing:
+				if (target.key.load(std::memory_order_relaxed) == key_bits)
+				{
+					value_bits = target.value.load(std::memory_order_seq_cst);
+					return lookup::found;
+				}
+				break;
+			case moved_full:
+				if (target.key.load(std::memory_order_relaxed) == key_bits)
+					return lookup::next;
+				break;
+			case moved_empty:
+				return lookup::next;
+			}
+		}
+
+		return tab.next.load(std::memory_order_acquire) ? lookup::next : lookup::absent;
+	}
+
+	bool write(const K &key, const V &value, bool assign)
+	{
+		auto curr = root_.load(std::memory_order_acquire);
+		if (curr->next.load(std::memory_order_acquire))
+			help_migrate(*curr);
+
+		return write_in(curr, to_bits(key), to_bits(value), hash_(key), assign, true);
+	}
+
+	//Inserts or assigns in `tab`, moving on to later tables as the probe sequence requires.
+	//`count_new` is false for migration, which moves keys rather than adding them.
+	bool write_in(table *tab, std::uint64_t key_bits, std::uint64_t value_bits,
+		size_type hash, bool assign, bool count_new)
+	{
+		while (true)
+		{
+			auto mask = tab->mask();
+			size_type probe = 0;
+			while (probe <= mask)
+			{
+				auto &target = tab->slots[(hash + probe) & mask];
+				auto state = target.state.load(std::memory_order_acquire);
+
+				if (state == empty)
+				{
+					std::uint32_t expected = empty;
+					if (!target.state.compare_exchange_strong(expected, claimed, std::memory_order_acq_rel))
+						continue; //Lost the race; look at this slot again.
+
+					target.key.store(key_bits, std::memory_order_relaxed);
+					target.value.store(value_bits, std::memory_order_relaxed);
+					target.state.store(ready, std::memory_order_release);
+
+					if (count_new)
+						size_.fetch_add(1, std::memory_order_relaxed);
+					if (tab->count.fetch_add(1, std::memory_order_relaxed) + 1 > tab->capacity() / 2)
+						start_resize(*tab);
+					return true;
+				}
+
+				if (state == claimed)
+					state = wait_while(target, claimed);
+
+				if (state == moved_empty)
+					break;
+
+				if (target.key.load(std::memory_order_relaxed) != key_bits)
+				{
+					++probe;
+					continue;
+				}
+
+				//The key is in this slot, or has moved on from it.
+				if (!assign)
+					return false;
+
+				if (state == ready)
+				{
+					target.value.store(value_bits, std::memory_order_seq_cst);
+					if (target.state.load(std::memory_order_seq_cst) == ready)
+						return false;
+				}
+
+				//Being migrated; redo the write in the next table once the copy is there.
+				wait_while(target, freezing);
+				break;
+			}
+
+			//Either the probe ran into a migrated slot, or the table is completely full.
+			if (!tab->next.load(std::memory_order_acquire))
+				start_resize(*tab);
+			tab = tab->next.load(std::memory_order_acquire);
+		}
+	}
+
+	//Links a table of twice the size after `tab`, unless another thread already did.
+	void start_resize(table &tab)
+	{
+		if (tab.next.load(std::memory_order_acquire))
+			return;
+
+		auto bigger = new table(tab.capacity() * 2);
+		table *expected = nullptr;
+		if (!tab.next.compare_exchange_strong(expected, bigger, std::memory_order_acq_rel))
+			delete bigger;
+	}
+
+	//Migrates one unclaimed chunk of `tab` into its next table.
+	//Whoever finishes the last chunk makes the next table the root.
+	void help_migrate(table &tab)
+	{
+		auto chunk = tab.next_chunk.fetch_add(1, std::memory_order_relaxed);
+		if (chunk >= tab.chunk_count())
+			return;
+
+		auto next = tab.next.load(std::memory_order_acquire);
+		auto first = chunk * migrate_chunk;
+		auto last = first + migrate_chunk < tab.capacity() ? first + migrate_chunk : tab.capacity();
+		for (auto ix = first; ix != last; ++ix)
+			migrate_slot(tab.slots[ix], next);
+
+		if (tab.chunks_done.fetch_add(1, std::memory_order_acq_rel) + 1 == tab.chunk_count())
+		{
+			table *expected = &tab;
+			root_.compare_exchange_strong(expected, next, std::memory_order_acq_rel);
+		}
+	}
+
+	void migrate_slot(slot &target, table *next)
+	{
+		while (true)
+		{
+			auto state = target.state.load(std::memory_order_acquire);
+			if (state == empty)
+			{
+				std::uint32_t expected = empty;
+				if (target.state.compare_exchange_strong(expected, moved_empty, std::memory_order_acq_rel))
+					return;
+			}
+			else if (state == claimed)
+			{
+				wait_while(target, claimed);
+			}
+			else if (state == ready)
+			{
+				std::uint32_t expected = ready;
+				if (target.state.compare_exchange_strong(expected, freezing, std::memory_order_seq_cst))
+				{
+					//Writers that assigned before the freeze are visible here; later ones will retry.
+					auto key_bits = target.key.load(std::memory_order_relaxed);
+					auto value_bits = target.value.load(std::memory_order_seq_cst);
+
+					//A writer that skipped past an already-migrated slot may have put a newer value there.
+					K key;
+					std::memcpy(&key, &key_bits, sizeof(K));
+					write_in(next, key_bits, value_bits, hash_(key), false, false);
+					target.state.store(moved_full, std::memory_order_release);
+					return;
+				}
+			}
+			else
+			{
+				return;
+			}
+		}
+	}
+};
+
+template<typename K, typename V, typename Hash>
+constexpr typename concurrent_hash_map<K, V, Hash>::size_type concurrent_hash_map<K, V, Hash>::migrate_chunk;
+
+#endif //CONCURRENT_HASH_MAP_HEADER
@@ -0,0 +1,289 @@
+#ifndef DICT_VECTOR_HEADER
+#define DICT_VECTOR_HEADER
+
+#include "my_vector.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+
+///A dictionary-encoded sequence of `T`s, for data with few distinct values.
+///Each distinct value is stored once in the dictionary. The sequence itself
+///is a `my_vector` of integer codes into that dictionary. Codes start out 8 bits wide,
+///and are widened to 16 and then 32 bits as the dictionary grows.
+///Predicates can be evaluated once per dictionary entry and then applied to the codes,
+///without decoding the sequence.
+template<typename T, typename Hash = std::hash<T>, typename KeyEqual = std::equal_to<T>>
+class dict_vector
+{
+public:
+	using value_type = T;
+	using size_type = std::size_t;
+	using code_type = std::uint32_t;
+	using const_reference = const T&;
+
+	///The code returned when a value is not in the dictionary.
+	static constexpr code_type npos = ~code_type(0);
+
+	dict_vector() = default;
+
+	explicit dict_vector(const Hash &hash, const KeyEqual &equal = KeyEqual())
+		: hash_(hash), equal_(equal) {}
+
+	dict_vector(dict_vector &&) = default;
+	dict_vector &operator=(dict_vector &&) = default;
+
+	size_type size() const noexcept
+	{
+		return visit_codes([](const auto &codes) { return codes.size(); });
+	}
+
+	bool empty() const noexcept { return size() == 0; }
+
+	///The number of distinct values that have been stored.
+	size_type cardinality() const noexcept { return dict_.size(); }
+
+	///The size in bytes of each code in the sequence: 1, 2 or 4.
+	unsigned code_width() const noexcept { return width_; }
+
+	///The deduplicated values. Codes index into this vector.
+	const my_vector<T> &dictionary() const noexcept { return dict_; }
+
+	const_reference operator[](size_type ix) const { return dict_[code_at(ix)]; }
+
+	const_reference at(size_type ix) const
+	{
+		if (ix < size())
+			return (*this)[ix];
+		throw std::out_of_range("Out of range");
+	}
+
+	code_type code_at(size_type ix) const
+	{
+		return visit_codes([ix](const auto &codes) { return code_type(codes[ix]); });
+	}
+
+	///Returns the code for `value`, or `npos` if it is not in the dictionary.
+	code_type find_code(const T &value) const
+	{
+		if (slots_.empty())
+			return npos;
+
+		return slots_[find_slot(value)];
+	}
+
+	void reserve(size_type new_cap)
+	{
+		visit_codes([new_cap](auto &codes) { codes.reserve(new_cap); });
+	}
+
+	///Removes all elements and empties the dictionary.
+	///Codes go back to being 8 bits wide.
+	void clear() noexcept
+	{
+		codes8_.clear();
+		codes16_ = my_vector<std::uint16_t>();
+		codes32_ = my_vector<std::uint32_t>();
+		dict_.clear();
+		slots_ = my_vector<code_type>();
+		width_ = 1;
+	}
+
+	void push_back(const T &value) { append_code(intern(value)); }
+	void push_back(T &&value) { append_code(intern(std::move(value))); }
+
+	///Appends the position of every element equal to `value` to `out`.
+	///The dictionary is searched once; the scan only compares codes.
+	void find_equal(const T &value, my_vector<size_type> &out) const
+	{
+		auto code = find_code(value);
+		if (code == npos)
+			return;
+
+		visit_codes([code, &out](const auto &codes)
+		{
+			for (size_type ix = 0; ix < codes.size(); ++ix)
+			{
+				if (codes[ix] == code)
+					out.push_back(ix);
+			}
+		});
+	}
+
+	///Appends the position of every element for which `pred` returns true to `out`.
+	///`pred` is called exactly once for each dictionary entry, not for each element.
+	template<typename Pred>
+	void find_if(Pred pred, my_vector<size_type> &out) const
+	{
+		my_vector<unsigned char> matches(dict_.size(), 0);
+		for (size_type code = 0; code < dict_.size(); ++code)
+			matches[code] = pred(dict_[code]) ? 1 : 0;
+
+		visit_codes([&matches, &out](const auto &codes)
+		{
+			for (size_type ix = 0; ix < codes.size(); ++ix)
+			{
+				if (matches[codes[ix]])
+					out.push_back(ix);
+			}
+		});
+	}
+
+	///Counts the elements equal to `value`, comparing only codes.
+	size_type count_equal(const T &value) const
+	{
+		auto code = find_code(value);
+		if (code == npos)
+			return 0;
+
+		return visit_codes([code](const auto &codes)
+		{
+			size_type count = 0;
+			for (auto curr : codes)
+				count += (curr == code);
+			return count;
+		});
+	}
+
+	///Appends the decoded sequence to `out`.
+	///`out` is reserved once for the whole sequence.
+	void decode(my_vector<T> &out) const
+	{
+		out.reserve(out.size() + size());
+		visit_codes([this, &out](const auto &codes)
+		{
+			for (auto code : codes)
+				out.push_back(dict_[code]);
+		});
+	}
+
+	my_vector<T> decode() const
+	{
+		my_vector<T> out;
+		decode(out);
+		return out;
+	}
+
+private:
+	Hash hash_;
+	KeyEqual equal_;
+	//The distinct values, in order of first appearance.
+	my_vector<T> dict_;
+	//Open-addressing index from value to code. Always a power of two in size, or empty.
+	my_vector<code_type> slots_;
+	//Only the vector matching `width_` is ever in use.
+	my_vector<std::uint8_t> codes8_;
+	my_vector<std::uint16_t> codes16_;
+	my_vector<std::uint32_t> codes32_;
+	unsigned width_ = 1;
+
+	//Calls `func` with the code vector currently in use.
+	template<typename Func>
+	decltype(auto) visit_codes(Func &&func)
+	{
+		switch (width_)
+		{
+		case 1: return func(codes8_);
+		case 2: return func(codes16_);
+		default: return func(codes32_);
+		}
+	}
+
+	template<typename Func>
+	decltype(auto) visit_codes(Func &&func) const
+	{
+		switch (width_)
+		{
+		case 1: return func(codes8_);
+		case 2: return func(codes16_);
+		default: return func(codes32_);
+		}
+	}
+
+	void append_code(code_type code)
+	{
+		visit_codes([code](auto &codes)
+		{
+			using code_t = typename std::decay_t<decltype(codes)>::value_type;
+			codes.push_back(code_t(code));
+		});
+	}
+
+	//Returns the index of the slot holding `value`, or of the empty slot where it would go.
+	//`slots_` must not be empty.
+	size_type find_slot(const T &value) const
+	{
+		auto mask = slots_.size() - 1;
+		auto ix = hash_(value) & mask;
+		while (true)
+		{
+			auto code = slots_[ix];
+			if (code == npos || equal_(dict_[code], value))
+				return ix;
+			ix = (ix + 1) & mask;
+		}
+	}
+
+	//Returns the code for `value`, adding it to the dictionary if needed.
+	template<typename U>
+	code_type intern(U &&value)
+	{
+		//Keep the load factor at or below one half.
+		if ((dict_.size() + 1) * 2 > slots_.size())
+			rehash(slots_.empty() ? 16 : slots_.size() * 2);
+
+		auto slot = find_slot(value);
+		if (slots_[slot] != npos)
+			return slots_[slot];
+
+		auto code = dict_.size();
+		if (code >= npos)
+			throw std::length_error("dict_vector: too many distinct values");
+
+		if (width_ == 1 && code > 0xFF)
+		{
+			widen_codes(codes8_, codes16_);
+			width_ = 2;
+		}
+		else if (width_ == 2 && code > 0xFFFF)
+		{
+			widen_codes(codes16_, codes32_);
+			width_ = 4;
+		}
+
+		dict_.push_back(std::forward<U>(value));
+		slots_[slot] = code_type(code);
+		return code_type(code);
+	}
+
+	void rehash(size_type slot_count)
+	{
+		my_vector<code_type> new_slots(slot_count, npos);
+		auto mask = slot_count - 1;
+		for (size_type code = 0; code < dict_.size(); ++code)
+		{
+			auto ix = hash_(dict_[code]) & mask;
+			while (new_slots[ix] != npos)
+				ix = (ix + 1) & mask;
+			new_slots[ix] = code_type(code);
+		}
+
+		slots_ = std::move(new_slots);
+	}
+
+	//Copies every code into the wider vector, keeping the capacity, and frees the narrow one.
+	template<typename From, typename To>
+	static void widen_codes(my_vector<From> &from, my_vector<To> &to)
+	{
+		to.reserve(from.capacity());
+		for (auto code : from)
+			to.push_back(To(code));
+		from = my_vector<From>();
+	}
+};
+
+template<typename T, typename Hash, typename KeyEqual>
+constexpr typename dict_vector<T, Hash, KeyEqual>::code_type dict_vector<T, Hash, KeyEqual>::npos;
+
+#endif //DICT_VECTOR_HEADER
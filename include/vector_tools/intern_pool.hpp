@@ -0,0 +1,366 @@
+#ifndef INTERN_POOL_HEADER
+#define INTERN_POOL_HEADER
+
+#include "my_vector.hpp"
+#include "shared_buffer.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+template<typename T, typename Hash>
+class intern_pool;
+
+namespace detail
+{
+	///True if equal values of `T` always have equal bytes, so that ranges of them
+	///can be hashed and compared as raw memory.
+	template<typename T>
+	struct is_bytewise_comparable : std::integral_constant<bool,
+		std::is_integral<T>::value || std::is_enum<T>::value || std::is_pointer<T>::value>
+	{};
+
+	inline std::uint64_t mix_hash(std::uint64_t hash, std::uint64_t word) noexcept
+	{
+		hash ^= word;
+		hash *= 0x9E3779B97F4A7C15ull;
+		return hash ^ (hash >> 29);
+	}
+
+	inline std::size_t hash_bytes(const void *data, std::size_t size) noexcept
+	{
+		auto bytes = static_cast<const unsigned char*>(data);
+		std::uint64_t hash = 0xCBF29CE484222325ull ^ size;
+		for (; size >= 8; bytes += 8, size -= 8)
+		{
+			std::uint64_t word;
+			std::memcpy(&word, bytes, 8);
+			hash = mix_hash(hash, word);
+		}
+
+		if (size != 0)
+		{
+			std::uint64_t word = 0;
+			std::memcpy(&word, bytes, size);
+			hash = mix_hash(hash, word);
+		}
+		return std::size_t(hash);
+	}
+
+	template<typename T>
+	struct interned_node : buffer_refcount<false>
+	{
+		template<typename ...Args>
+		interned_node(std::size_t hash, Args &&...args) : hash(hash), values(std::forward<Args>(args)...) {}
+
+		std::size_t hash;
+		my_vector<T> values;
+		//NULL once the pool is gone, leaving the node to its handles.
+		void *pool = nullptr;
+	};
+}
+
+///A shared, immutable handle to a vector interned by an `intern_pool`.
+///Handles to equal contents point to the same storage, so comparing them is a pointer comparison.
+///The storage is freed, and dropped from the pool, when the last handle to it is destroyed.
+template<typename T, typename Hash = std::hash<T>>
+class interned
+{
+public:
+	using value_type = T;
+	using size_type = std::size_t;
+	using const_iterator = const T*;
+
+	interned() noexcept : node_(nullptr) {}
+
+	interned(const interned &other) noexcept : node_(other.node_)
+	{
+		if (node_)
+			node_->acquire();
+	}
+
+	interned(interned &&other) noexcept : node_(other.node_)
+	{
+		other.node_ = nullptr;
+	}
+
+	~interned()
+	{
+		release();
+	}
+
+	interned &operator=(const interned &other) noexcept
+	{
+		interned temp(other);
+		swap(temp);
+		return *this;
+	}
+
+	interned &operator=(interned &&other) noexcept
+	{
+		interned temp(std::move(other));
+		swap(temp);
+		return *this;
+	}
+
+	void swap(interned &other) noexcept
+	{
+		std::swap(node_, other.node_);
+	}
+
+	///The interned contents. A default-constructed handle refers to an empty vector.
+	const my_vector<T> &get() const noexcept { return node_ ? node_->values : empty_values(); }
+
+	const T *data() const noexcept { return get().data(); }
+	size_type size() const noexcept { return get().size(); }
+	bool empty() const noexcept { return get().empty(); }
+	const T &operator[](size_type ix) const { return get()[ix]; }
+	const_iterator begin() const noexcept { return get().begin(); }
+	const_iterator end() const noexcept { return get().end(); }
+
+	///The content hash, computed once when the contents were interned.
+	size_type hash() const noexcept { return node_ ? node_->hash : 0; }
+
+	///The number of handles sharing these contents.
+	size_type use_count() const noexcept { return node_ ? node_->use_count() : 0; }
+
+	friend bool operator==(const interned &lhs, const interned &rhs) noexcept { return lhs.node_ == rhs.node_; }
+	friend bool operator!=(const interned &lhs, const interned &rhs) noexcept { return lhs.node_ != rhs.node_; }
+
+private:
+	friend class intern_pool<T, Hash>;
+
+	using node_type = detail::interned_node<T>;
+
+	node_type *node_;
+
+	//Adopts a reference that has already been acquired.
+	explicit interned(node_type *node) noexcept : node_(node) {}
+
+	static const my_vector<T> &empty_values() noexcept
+	{
+		static const my_vector<T> values;
+		return values;
+	}
+
+	void release() noexcept
+	{
+		if (node_ && node_->release())
+		{
+			if (node_->pool)
+				static_cast<intern_pool<T, Hash>*>(node_->pool)->forget(node_);
+			delete node_;
+		}
+		node_ = nullptr;
+	}
+};
+
+///Interns vectors, so that every distinct list of values is stored once
+///and shared by all the `interned` handles to it.
+///Contents are found through an open-addressing table of nodes keyed by content hash.
+///Integer, enum and pointer elements are hashed and compared as raw memory;
+///other types use `Hash` and `operator==` element by element.
+///Neither the pool nor its handles are thread-safe. Handles may outlive the pool.
+template<typename T, typename Hash = std::hash<T>>
+class intern_pool
+{
+public:
+	using value_type = T;
+	using size_type = std::size_t;
+	using handle = interned<T, Hash>;
+
+	explicit intern_pool(const Hash &hash = Hash()) : hash_(hash), slots_(16) {}
+
+	intern_pool(const intern_pool &) = delete;
+	intern_pool &operator=(const intern_pool &) = delete;
+
+	~intern_pool()
+	{
+		for (auto node : slots_)
+		{
+			if (node)
+				node->pool = nullptr;
+		}
+	}
+
+	///The number of distinct contents currently interned.
+	size_type size() const noexcept { return count_; }
+
+	///The bytes of storage held for the interned contents and the table.
+	size_type memory_bytes() const noexcept
+	{
+		size_type bytes = slots_.capacity() * sizeof(node_type*);
+		for (auto node : slots_)
+		{
+			if (node)
+				bytes += sizeof(node_type) + node->values.capacity() * sizeof(T);
+		}
+		return bytes;
+	}
+
+	///Returns the handle for the `count` values at `first`, copying them only if they are new.
+	handle intern(const T *first, size_type count)
+	{
+		auto hash = hash_range(first, count);
+		auto slot = find_slot(first, count, hash);
+		if (slots_[slot])
+			return share(slots_[slot]);
+
+		//A new node starts out with the one reference this handle holds.
+		std::unique_ptr<node_type> node(new node_type(hash, first, first + count));
+		insert_node(slot, node.get());
+		return handle(node.release());
+	}
+
+	handle intern(const my_vector<T> &values)
+	{
+		return intern(values.data(), values.size());
+	}
+
+	///As above, but new contents take over `values`' storage rather than copying it.
+	handle intern(my_vector<T> &&values)
+	{
+		auto hash = hash_range(values.data(), values.size());
+		auto slot = find_slot(values.data(), values.size(), hash);
+		if (slots_[slot])
+			return share(slots_[slot]);
+
+		std::unique_ptr<node_type> node(new node_type(hash, std::move(values)));
+		insert_node(slot, node.get());
+		return handle(node.release());
+	}
+
+private:
+	friend class interned<T, Hash>;
+
+	using node_type = detail::interned_node<T>;
+
+	Hash hash_;
+	//Nodes, or NULL for an empty slot. At most half full.
+	my_vector<node_type*> slots_;
+	size_type count_ = 0;
+
+	size_type mask() const noexcept { return slots_.size() - 1; }
+
+	size_type hash_range(const T *first, size_type count) const
+	{
+		return hash_range(first, count, detail::is_bytewise_comparable<T>{});
+	}
+
+	size_type hash_range(const T *first, size_type count, std::true_type) const noexcept
+	{
+		return detail::hash_bytes(first, count * sizeof(T));
+	}
+
+	size_type hash_range(const T *first, size_type count, std::false_type) const
+	{
+		std::uint64_t hash = 0xCBF29CE484222325ull ^ count;
+		for (size_type ix = 0; ix != count; ++ix)
+			hash = detail::mix_hash(hash, hash_(first[ix]));
+		return size_type(hash);
+	}
+
+	static bool equal_range(const my_vector<T> &values, const T *first, size_type count)
+	{
+		if (values.size() != count)
+			return false;
+		return equal_range(values.data(), first, count, detail::is_bytewise_comparable<T>{});
+	}
+
+	static bool equal_range(const T *lhs, const T *rhs, size_type count, std::true_type) noexcept
+	{
+		return count == 0 || std::memcmp(lhs, rhs, count * sizeof(T)) == 0;
+	}
+
+	static bool equal_range(const T *lhs, const T *rhs, size_type count, std::false_type)
+	{
+		return std::equal(lhs, lhs + count, rhs);
+	}
+
+	//Returns the slot holding these contents, or the empty slot that ends their probe sequence.
+	size_type find_slot(const T *first, size_type count, size_type hash) const
+	{
+		auto slot = hash & mask();
+		while (auto node = slots_[slot])
+		{
+			if (node->hash == hash && equal_range(node->values, first, count))
+				return slot;
+			slot = (slot + 1) & mask();
+		}
+		return slot;
+	}
+
+	//Stores `node` in the empty slot `slot`, first doubling the table if it would end up over half full.
+	void insert_node(size_type slot, node_type *node)
+	{
+		if ((count_ + 1) * 2 > slots_.size())
+		{
+			my_vector<node_type*> old(slots_.size() * 2);
+			old.swap(slots_);
+			for (auto curr : old)
+			{
+				if (curr)
+					slots_[empty_slot(curr->hash)] = curr;
+			}
+			slot = empty_slot(node->hash);
+		}
+
+		node->pool = this;
+		slots_[slot] = node;
+		++count_;
+	}
+
+	size_type empty_slot(size_type hash) const noexcept
+	{
+		auto slot = hash & mask();
+		while (slots_[slot])
+			slot = (slot + 1) & mask();
+		return slot;
+	}
+
+	static handle share(node_type *node) noexcept
+	{
+		node->acquire();
+		return handle(node);
+	}
+
+	//Removes `node`, whose last handle is going away, shifting later entries of its probe run back.
+	void forget(node_type *node) noexcept
+	{
+		auto hole = node->hash & mask();
+		while (slots_[hole] != node)
+			hole = (hole + 1) & mask();
+
+		auto curr = hole;
+		while (true)
+		{
+			curr = (curr + 1) & mask();
+			if (!slots_[curr])
+				break;
+
+			auto home = slots_[curr]->hash & mask();
+			if (((curr - home) & mask()) >= ((curr - hole) & mask()))
+			{
+				slots_[hole] = slots_[curr];
+				hole = curr;
+			}
+		}
+		slots_[hole] = nullptr;
+		--count_;
+	}
+};
+
+namespace std
+{
+	template<typename T, typename Hash>
+	struct hash<interned<T, Hash>>
+	{
+		std::size_t operator()(const interned<T, Hash> &value) const noexcept { return value.hash(); }
+	};
+}
+
+#endif //INTERN_POOL_HEADER
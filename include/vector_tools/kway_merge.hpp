@@ -0,0 +1,461 @@
+#ifndef VECTOR_TOOLS_KWAY_MERGE_HEADER
+#define VECTOR_TOOLS_KWAY_MERGE_HEADER
+
+#include "my_vector.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace vector_tools
+{
+	namespace detail
+	{
+		//The head of a range as the loser tree holds it: a pointer to it, null once the range is exhausted.
+		template<typename T, bool Copy>
+		struct range_head
+		{
+			const T *ptr;
+
+			range_head(const T *head = nullptr) noexcept : ptr(head) {}
+			bool live() const noexcept { return ptr != nullptr; }
+			const T &get() const noexcept { return *ptr; }
+		};
+
+		//For small trivial types, a copy, so comparisons read the tree's own storage
+		//rather than chasing pointers into `k` different ranges.
+		template<typename T>
+		struct range_head<T, true>
+		{
+			T value;
+			bool is_live;
+
+			range_head(const T *head = nullptr) noexcept : value(head ? *head : T()), is_live(head != nullptr) {}
+			bool live() const noexcept { return is_live; }
+			const T &get() const noexcept { return value; }
+		};
+
+		///A tournament tree over `k` sorted ranges, recording at each inner node the range that lost there.
+		///The overall winner is the range whose head comes first; ties go to the lower-numbered range,
+		///which makes merging stable. After the winner's head is taken, one replay up its path,
+		///`log2(k)` comparisons, finds the next winner.
+		template<typename Ptr, typename Compare>
+		class loser_tree
+		{
+		public:
+			using value_type = typename std::iterator_traits<Ptr>::value_type;
+
+			loser_tree(my_vector<std::pair<Ptr, Ptr>> &ranges, Compare &comp)
+				: ranges_(ranges), comp_(comp), leaves_(1)
+			{
+				while (leaves_ < ranges.size())
+					leaves_ *= 2;
+
+				//Play the tournament bottom-up; leaves past the last range are empty and always lose.
+				my_vector<entry> winners(leaves_ * 2);
+				losers_.resize(leaves_);
+				for (std::size_t leaf = 0; leaf != leaves_; ++leaf)
+					winners[leaves_ + leaf] = { leaf < ranges.size() ? head_of(leaf) : nullptr, leaf };
+
+				for (auto node = leaves_ - 1; node != 0; --node)
+				{
+					auto left = winners[node * 2];
+					auto right = winners[node * 2 + 1];
+					bool left_wins = beats(left, right);
+					winners[node] = left_wins ? left : right;
+					losers_[node] = left_wins ? right : left;
+				}
+				winner_ = winners[1];
+			}
+
+			std::size_t winner() const noexcept { return winner_.range; }
+			bool exhausted() const noexcept { return !winner_.head.live(); }
+
+			///Plays the winner, whose head has changed, back up to the root.
+			void replay()
+			{
+				entry candidate{ head_of(winner_.range), winner_.range };
+				for (auto node = (leaves_ + candidate.range) / 2; node != 0; node /= 2)
+				{
+					if (beats(losers_[node], candidate))
+						std::swap(losers_[node], candidate);
+				}
+				winner_ = candidate;
+			}
+
+			///The range that would win if the current winner were removed: the best of those it beat
+			///on the way up. It is exhausted if every other range is.
+			std::size_t runner_up() const
+			{
+				entry best{ nullptr, leaves_ };
+				for (auto node = (leaves_ + winner_.range) / 2; node != 0; node /= 2)
+				{
+					if (beats(losers_[node], best))
+						best = losers_[node];
+				}
+				return best.range;
+			}
+
+		private:
+			static constexpr bool copy_heads = std::is_trivial<value_type>::value && sizeof(value_type) <= 16;
+
+			//A range and its head, kept together so that a comparison loads nothing but the two entries.
+			struct entry
+			{
+				range_head<value_type, copy_heads> head;
+				std::size_t range;
+			};
+
+			const value_type *head_of(std::size_t range) const
+			{
+				auto &curr = ranges_[range];
+				return curr.first != curr.second ? std::addressof(*curr.first) : nullptr;
+			}
+
+			//True if `a`'s head comes before `b`'s. Ties go to the lower-numbered range.
+			bool beats(const entry &a, const entry &b) const
+			{
+				return beats(a, b, std::integral_constant<bool, copy_heads>{});
+			}
+
+			//A pointer head may be null, so exhausted ranges are settled first.
+			//If `a` is lower it wins unless `b` is strictly less, otherwise it must be strictly less: one comparison.
+			bool beats(const entry &a, const entry &b, std::false_type) const
+			{
+				if (!a.head.live() || !b.head.live())
+					return a.head.live();
+
+				return a.range < b.range ? !comp_(b.head.get(), a.head.get()) : comp_(a.head.get(), b.head.get());
+			}
+
+			//A copied head is cheap to compare and always can be, so both comparisons are made and combined
+			//without branches; which way they go is data-dependent and would mispredict often.
+			bool beats(const entry &a, const entry &b, std::true_type) const
+			{
+				bool a_less = comp_(a.head.get(), b.head.get());
+				bool b_less = comp_(b.head.get(), a.head.get());
+				bool ordered = a_less | (!b_less & (a.range < b.range));
+				return a.head.live() & (!b.head.live() | ordered);
+			}
+
+			my_vector<std::pair<Ptr, Ptr>> &ranges_;
+			Compare &comp_;
+			std::size_t leaves_;
+			my_vector<entry> losers_;
+			entry winner_{ nullptr, 0 };
+		};
+
+		//How an element gets from a run to the output: copied or moved.
+		template<typename Ptr>
+		Ptr transfer_iterator(Ptr ptr, std::false_type) { return ptr; }
+
+		template<typename Ptr>
+		std::move_iterator<Ptr> transfer_iterator(Ptr ptr, std::true_type) { return std::make_move_iterator(ptr); }
+
+		//Appends to a `my_vector` whose capacity has been reserved.
+		template<typename T, typename Alloc>
+		struct append_sink
+		{
+			my_vector<T, Alloc> &out;
+
+			template<typename It>
+			void bulk(It first, It last) { out.insert(out.end(), first, last); }
+
+			template<typename It>
+			void one(It it) { out.push_back(*it); }
+		};
+
+		//Assigns over existing elements, for the parallel merge where each thread owns a slice of the output.
+		template<typename T>
+		struct assign_sink
+		{
+			T *pos;
+
+			template<typename It>
+			void bulk(It first, It last) { pos = std::copy(first, last, pos); }
+
+			template<typename It>
+			void one(It it) { *pos++ = *it; }
+		};
+
+		//A run must win this many times in a row before the merge looks for a block of it
+		//that does not interleave with any other run.
+		constexpr std::size_t min_gallop = 4;
+
+		//The end of the block at the start of `first/last` that comes before `key`, the head of the runner-up,
+		//found by exponential search. Elements equal to `key` are included if `ties_first`.
+		template<typename Ptr, typename T, typename Compare>
+		Ptr gallop(Ptr first, Ptr last, const T &key, bool ties_first, Compare &comp)
+		{
+			auto before = [&](const T &elem) { return ties_first ? !comp(key, elem) : comp(elem, key); };
+
+			std::size_t step = 1;
+			auto lo = first;
+			auto hi = first;
+			while (hi != last && before(*hi))
+			{
+				lo = hi + 1;
+				hi = std::size_t(last - lo) > step ? lo + step : last;
+				step *= 2;
+			}
+			return std::partition_point(lo, hi, before);
+		}
+
+		//Merges the `ranges` into `sink`, moving elements if `Move` is true.
+		template<typename Ptr, typename Compare, typename Sink, typename Move>
+		void merge_ranges(my_vector<std::pair<Ptr, Ptr>> &ranges, Compare &comp, Sink &sink, Move move)
+		{
+			if (ranges.empty())
+				return;
+
+			if (ranges.size() == 1)
+			{
+				sink.bulk(transfer_iterator(ranges[0].first, move), transfer_iterator(ranges[0].second, move));
+				return;
+			}
+
+			loser_tree<Ptr, Compare> tree(ranges, comp);
+			auto last_winner = ranges.size();
+			std::size_t streak = 0;
+			for (; !tree.exhausted(); tree.replay())
+			{
+				auto range = tree.winner();
+				streak = range == last_winner ? streak + 1 : 1;
+				last_winner = range;
+
+				auto &curr = ranges[range];
+				if (streak < min_gallop)
+				{
+					sink.one(transfer_iterator(curr.first, move));
+					++curr.first;
+				}
+				else
+				{
+					//Everything up to the next run's head goes in one bulk copy.
+					auto other = tree.runner_up();
+					auto block_end = other >= ranges.size() || ranges[other].first == ranges[other].second ? curr.second :
+						gallop(curr.first, curr.second, *ranges[other].first, range < other, comp);
+					sink.bulk(transfer_iterator(curr.first, move), transfer_iterator(block_end, move));
+					curr.first = block_end;
+					streak = 0;
+				}
+			}
+		}
+
+		template<typename Ptr, typename Runs>
+		my_vector<std::pair<Ptr, Ptr>> run_ranges(Runs &runs)
+		{
+			my_vector<std::pair<Ptr, Ptr>> ranges;
+			ranges.reserve(runs.size());
+			for (auto &run : runs)
+			{
+				if (!run.empty())
+					ranges.push_back({ run.data(), run.data() + run.size() });
+			}
+			return ranges;
+		}
+
+		//Trivial elements are written straight into the output, sized once and left unwritten until then.
+		template<typename T, typename Ptr, typename Compare, typename Move>
+		void merge_into(my_vector<T> &out, std::size_t total, my_vector<std::pair<Ptr, Ptr>> &ranges,
+			Compare &comp, Move move, std::true_type)
+		{
+			out.resize_default_init(total);
+			assign_sink<T> sink{ out.data() };
+			merge_ranges(ranges, comp, sink, move);
+		}
+
+		//Others are constructed in place at the end of reserved storage.
+		template<typename T, typename Ptr, typename Compare, typename Move>
+		void merge_into(my_vector<T> &out, std::size_t total, my_vector<std::pair<Ptr, Ptr>> &ranges,
+			Compare &comp, Move move, std::false_type)
+		{
+			out.reserve(total);
+			append_sink<T, std::allocator<T>> sink{ out };
+			merge_ranges(ranges, comp, sink, move);
+		}
+
+		template<typename Runs>
+		std::size_t total_size(const Runs &runs)
+		{
+			std::size_t total = 0;
+			for (auto &run : runs)
+				total += run.size();
+			return total;
+		}
+	}
+
+	///Merges the sorted `runs` into one sorted vector, using a loser tree to pick each next element.
+	///The output is allocated once. A run that wins several times in a row is checked for a block
+	///that precedes every other run's head, and that block is copied in one go.
+	///The merge is stable: equal elements keep the order of their runs.
+	template<typename T, typename Alloc, typename OuterAlloc, typename Compare = std::less<T>>
+	my_vector<T> merge_runs(const my_vector<my_vector<T, Alloc>, OuterAlloc> &runs, Compare comp = Compare())
+	{
+		my_vector<T> out;
+		auto ranges = detail::run_ranges<const T*>(runs);
+		detail::merge_into(out, detail::total_size(runs), ranges, comp, std::false_type{}, std::is_trivial<T>{});
+		return out;
+	}
+
+	///As above, moving the elements out of the runs.
+	template<typename T, typename Alloc, typename OuterAlloc, typename Compare = std::less<T>>
+	my_vector<T> merge_runs(my_vector<my_vector<T, Alloc>, OuterAlloc> &&runs, Compare comp = Compare())
+	{
+		my_vector<T> out;
+		auto ranges = detail::run_ranges<T*>(runs);
+		detail::merge_into(out, detail::total_size(runs), ranges, comp, std::true_type{}, std::is_trivial<T>{});
+		return out;
+	}
+
+	namespace detail
+	{
+		//Picks `parts - 1` splitter keys that divide the runs' elements into roughly equal parts.
+		//Each run contributes evenly spaced samples, weighted by how many elements each stands for.
+		template<typename T, typename Runs, typename Compare>
+		my_vector<T> choose_splitters(const Runs &runs, std::size_t total, std::size_t parts, Compare &comp)
+		{
+			struct sample
+			{
+				const T *key;
+				std::size_t weight;
+			};
+
+			auto per_run = parts * 8;
+			my_vector<sample> samples;
+			for (auto &run : runs)
+			{
+				auto count = std::min(run.size(), per_run);
+				for (std::size_t ix = 0; ix != count; ++ix)
+				{
+					auto first = run.size() * ix / count;
+					auto next = run.size() * (ix + 1) / count;
+					samples.push_back({ run.data() + first, next - first });
+				}
+			}
+
+			std::sort(samples.begin(), samples.end(),
+				[&comp](const sample &lhs, const sample &rhs) { return comp(*lhs.key, *rhs.key); });
+
+			my_vector<T> splitters;
+			splitters.reserve(parts - 1);
+			std::size_t seen = 0;
+			std::size_t part = 1;
+			for (auto &curr : samples)
+			{
+				seen += curr.weight;
+				while (part < parts && seen >= total * part / parts)
+				{
+					if (splitters.empty() || comp(splitters.back(), *curr.key))
+						splitters.push_back(*curr.key);
+					++part;
+				}
+			}
+			return splitters;
+		}
+	}
+
+	///Merges the sorted `runs` as `merge_runs` does, using up to `thread_count` threads
+	///(0 for one per hardware thread). Splitter keys sampled from the runs divide the output into parts,
+	///each holding the elements between two splitters; every run is split at the splitters by binary search,
+	///and each thread merges its part directly into its slice of the output.
+	///`T` must be default constructible. The merge is stable.
+	template<typename T, typename Alloc, typename OuterAlloc, typename Compare = std::less<T>>
+	my_vector<T> merge_runs_parallel(const my_vector<my_vector<T, Alloc>, OuterAlloc> &runs,
+		unsigned thread_count, Compare comp = Compare())
+	{
+		if (thread_count == 0)
+			thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+		auto total = detail::total_size(runs);
+
+		//Threads are not worth starting for fewer elements than this each.
+		constexpr std::size_t min_part = std::size_t(1) << 16;
+		auto parts = std::max<std::size_t>(1, std::min<std::size_t>(thread_count, total / min_part));
+		if (parts == 1)
+			return merge_runs(runs, comp);
+
+		auto splitters = detail::choose_splitters<T>(runs, total, parts, comp);
+		parts = splitters.size() + 1;
+
+		//bounds[part * k + run] is where part `part` starts in run `run`; elements equal to a splitter
+		//all fall after it, so equal elements are never split between parts.
+		auto k = runs.size();
+		my_vector<std::size_t> bounds((parts + 1) * k);
+		my_vector<std::size_t> offsets(parts + 1);
+		for (std::size_t part = 0; part <= parts; ++part)
+		{
+			for (std::size_t run = 0; run != k; ++run)
+			{
+				auto &curr = runs[run];
+				std::size_t bound = 0;
+				if (part == parts)
+					bound = curr.size();
+				else if (part != 0)
+					bound = std::size_t(std::lower_bound(curr.begin(), curr.end(), splitters[part - 1], comp) - curr.begin());
+				bounds[part * k + run] = bound;
+				offsets[part] += bound;
+			}
+		}
+
+		my_vector<T> out;
+		out.resize_default_init(total);
+
+		my_vector<std::exception_ptr> errors(parts);
+		my_vector<std::thread> workers;
+		workers.reserve(parts - 1);
+
+		auto merge_part = [&](std::size_t part) {
+			try
+			{
+				my_vector<std::pair<const T*, const T*>> ranges;
+				ranges.reserve(k);
+				for (std::size_t run = 0; run != k; ++run)
+				{
+					auto first = bounds[part * k + run];
+					auto last = bounds[(part + 1) * k + run];
+					if (first != last)
+						ranges.push_back({ runs[run].data() + first, runs[run].data() + last });
+				}
+
+				auto part_comp = comp;
+				detail::assign_sink<T> sink{ out.data() + offsets[part] };
+				detail::merge_ranges(ranges, part_comp, sink, std::false_type{});
+			}
+			catch (...)
+			{
+				errors[part] = std::current_exception();
+			}
+		};
+
+		try
+		{
+			for (std::size_t part = 1; part < parts; ++part)
+				workers.emplace_back(merge_part, part);
+		}
+		catch (...)
+		{
+			for (auto &worker : workers)
+				worker.join();
+			throw;
+		}
+
+		merge_part(0);
+		for (auto &worker : workers)
+			worker.join();
+
+		for (auto &error : errors)
+		{
+			if (error)
+				std::rethrow_exception(error);
+		}
+		return out;
+	}
+}
+
+#endif //VECTOR_TOOLS_KWAY_MERGE_HEADER
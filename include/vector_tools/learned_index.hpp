@@ -0,0 +1,286 @@
+#ifndef LEARNED_INDEX_HEADER
+#define LEARNED_INDEX_HEADER
+
+#include "my_vector.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <limits>
+#include <thread>
+#include <type_traits>
+
+///A learned index over a sorted `my_vector` of integer keys.
+///The keys are covered by line segments, each predicting a key's position to within `epsilon`;
+///the segments' first keys are then indexed the same way, level upon level, until a single
+///segment remains. A lookup walks down the levels, each time predicting a position and searching
+///only the few elements around it, so it touches a handful of cache lines instead of the
+///`log2(n)` that a binary search does.
+///The index refers to the vector rather than copying it. It must be rebuilt whenever the vector changes.
+template<typename Key>
+class learned_index
+{
+public:
+	static_assert(std::is_integral<Key>::value, "Keys must be integers.");
+
+	using key_type = Key;
+	using size_type = std::size_t;
+
+	///Builds an index over `keys`, which must be sorted, using up to `thread_count` threads
+	///(0 for one per hardware thread). Positions of keys are predicted to within `epsilon`.
+	explicit learned_index(const my_vector<Key> &keys, size_type epsilon = 64, unsigned thread_count = 1)
+		: keys_(&keys), epsilon_(std::max<size_type>(epsilon, 1))
+	{
+		rebuild(thread_count);
+	}
+
+	///Refits the index to the current contents of the vector.
+	///The bottom level is fitted in parallel, each thread taking a slice of the keys.
+	void rebuild(unsigned thread_count = 1)
+	{
+		levels_.clear();
+		auto first = keys_->data();
+		auto size = keys_->size();
+		if (size == 0)
+			return;
+
+		levels_.emplace_back();
+		fit_parallel(first, size, epsilon_, levels_.back(), thread_count);
+
+		while (levels_.back().first_keys.size() > 1)
+		{
+			auto &below = levels_.back().first_keys;
+			level above;
+			fit(below.data(), 0, below.size(), internal_epsilon, above);
+			levels_.push_back(std::move(above));
+		}
+	}
+
+	///The position of the first key not less than `key`, as `std::lower_bound` would find it.
+	size_type lower_bound(Key key) const
+	{
+		auto &keys = *keys_;
+		if (keys.empty() || !(keys[0] < key))
+			return 0;
+
+		//Each level's segment predicts where `key` falls among the first keys of the level below.
+		size_type seg = 0;
+		for (auto curr = levels_.size() - 1; curr != 0; --curr)
+		{
+			auto &below = levels_[curr - 1].first_keys;
+			auto pos = predict(levels_[curr], seg, key, below.size());
+			seg = bounded_search(below.data(), below.size(), pos, internal_epsilon,
+				[key](Key elem) { return !(key < elem); }) - 1;
+		}
+
+		auto pos = predict(levels_[0], seg, key, keys.size());
+		return bounded_search(keys.data(), keys.size(), pos, epsilon_,
+			[key](Key elem) { return elem < key; });
+	}
+
+	///True if `key` is in the vector.
+	bool contains(Key key) const
+	{
+		auto pos = lower_bound(key);
+		return pos != keys_->size() && !(key < (*keys_)[pos]);
+	}
+
+	size_type epsilon() const noexcept { return epsilon_; }
+
+	///The number of levels, including the bottom one.
+	size_type height() const noexcept { return levels_.size(); }
+
+	///The number of segments fitted to the keys themselves.
+	size_type segment_count() const noexcept { return levels_.empty() ? 0 : levels_[0].first_keys.size(); }
+
+	///The bytes of storage owned by the index, not counting the keys.
+	size_type size_bytes() const noexcept
+	{
+		size_type bytes = levels_.capacity() * sizeof(level);
+		for (auto &curr : levels_)
+			bytes += curr.first_keys.capacity() * sizeof(Key) + curr.models.capacity() * sizeof(linear_model);
+		return bytes;
+	}
+
+private:
+	//Upper levels are small and searched on every lookup, so they are fitted more tightly.
+	static constexpr size_type internal_epsilon = 8;
+
+	using ukey_type = std::make_unsigned_t<Key>;
+
+	struct linear_model
+	{
+		double intercept;
+		double slope;
+	};
+
+	//Segments as parallel arrays: the first key each covers, and the line through its positions.
+	struct level
+	{
+		my_vector<Key> first_keys;
+		my_vector<linear_model> models;
+	};
+
+	const my_vector<Key> *keys_;
+	size_type epsilon_;
+	my_vector<level> levels_;
+
+	//`key - first` without overflow, given `first <= key`.
+	static double distance(Key first, Key key) noexcept
+	{
+		return double(ukey_type(ukey_type(key) - ukey_type(first)));
+	}
+
+	static size_type predict(const level &lev, size_type seg, Key key, size_type size) noexcept
+	{
+		auto &model = lev.models[seg];
+		auto pos = model.intercept + model.slope * distance(lev.first_keys[seg], key);
+		if (!(pos > 0))
+			return 0;
+		if (pos >= double(size - 1))
+			return size - 1;
+		return size_type(pos + 0.5);
+	}
+
+	//Finds the first element in `first[0, size)` for which `before` is false,
+	//searching within `epsilon` of `pos` and widening exponentially should the answer lie outside.
+	template<typename Before>
+	static size_type bounded_search(const Key *first, size_type size, size_type pos, size_type epsilon, Before before)
+	{
+		auto lo = pos > epsilon ? pos - epsilon : 0;
+		auto hi = std::min(size, pos + epsilon + 1);
+		auto step = epsilon + 1;
+
+		//The answer is in `[lo, hi]`: everything before `lo` is before it, and `first[hi]` is not.
+		while (lo > 0 && !before(first[lo - 1]))
+		{
+			hi = lo - 1;
+			lo = hi > step ? hi - step : 0;
+			step *= 2;
+		}
+		while (hi < size && before(first[hi]))
+		{
+			lo = hi + 1;
+			hi = std::min(size, lo + step);
+			step *= 2;
+		}
+
+		return size_type(std::partition_point(first + lo, first + hi, before) - first);
+	}
+
+	//Appends to `out` the segments for the sorted keys `first[begin, end)`, using the shrinking-cone method:
+	//a segment keeps taking keys while some slope still passes within `epsilon` of every one.
+	//Runs of equal keys are fitted at the position of their first element.
+	static void fit(const Key *first, size_type begin, size_type end, size_type epsilon, level &out)
+	{
+		auto eps = double(epsilon);
+		auto ix = begin;
+		while (ix != end)
+		{
+			auto start_key = first[ix];
+			auto start_pos = double(ix);
+			auto slope_lo = 0.0;
+			auto slope_hi = std::numeric_limits<double>::infinity();
+
+			auto next = ix + 1;
+			while (next != end && first[next] == start_key)
+				++next;
+
+			while (next != end)
+			{
+				auto dx = distance(start_key, first[next]);
+				auto lo = (double(next) - eps - start_pos) / dx;
+				auto hi = (double(next) + eps - start_pos) / dx;
+				if (lo > slope_hi || hi < slope_lo)
+					break;
+
+				slope_lo = std::max(slope_lo, lo);
+				slope_hi = std::min(slope_hi, hi);
+
+				auto curr_key = first[next];
+				while (++next != end && first[next] == curr_key)
+					;
+			}
+
+			auto slope = slope_hi == std::numeric_limits<double>::infinity() ? 0.0 : (slope_lo + slope_hi) / 2;
+			out.first_keys.push_back(start_key);
+			out.models.push_back({ start_pos, slope });
+			ix = next;
+		}
+	}
+
+	//Fits the keys in slices on separate threads, then joins the slices' segments in order.
+	//Slices start at the beginning of a run of equal keys, so no run is split between two segments.
+	static void fit_parallel(const Key *first, size_type size, size_type epsilon, level &out, unsigned thread_count)
+	{
+		if (thread_count == 0)
+			thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+		//Threads are not worth starting for fewer keys than this each.
+		constexpr size_type min_slice = size_type(1) << 16;
+		auto count = std::max<size_type>(1, std::min<size_type>(thread_count, size / min_slice));
+		if (count == 1)
+		{
+			fit(first, 0, size, epsilon, out);
+			return;
+		}
+
+		my_vector<size_type> bounds(count + 1);
+		for (size_type slice = 1; slice < count; ++slice)
+		{
+			auto bound = std::max(bounds[slice - 1], size * slice / count);
+			while (bound != 0 && bound != size && first[bound] == first[bound - 1])
+				++bound;
+			bounds[slice] = bound;
+		}
+		bounds[count] = size;
+
+		my_vector<level> slices(count);
+		my_vector<std::exception_ptr> errors(count);
+		my_vector<std::thread> workers;
+		workers.reserve(count - 1);
+
+		auto fit_slice = [&](size_type slice) {
+			try { fit(first, bounds[slice], bounds[slice + 1], epsilon, slices[slice]); }
+			catch (...) { errors[slice] = std::current_exception(); }
+		};
+
+		try
+		{
+			for (size_type slice = 1; slice < count; ++slice)
+				workers.emplace_back(fit_slice, slice);
+		}
+		catch (...)
+		{
+			for (auto &worker : workers)
+				worker.join();
+			throw;
+		}
+
+		fit_slice(0);
+		for (auto &worker : workers)
+			worker.join();
+
+		for (auto &error : errors)
+		{
+			if (error)
+				std::rethrow_exception(error);
+		}
+
+		size_type total = 0;
+		for (auto &slice : slices)
+			total += slice.first_keys.size();
+
+		out.first_keys.reserve(total);
+		out.models.reserve(total);
+		for (auto &slice : slices)
+		{
+			out.first_keys.insert(out.first_keys.end(), slice.first_keys.begin(), slice.first_keys.end());
+			out.models.insert(out.models.end(), slice.models.begin(), slice.models.end());
+		}
+	}
+};
+
+template<typename Key>
+constexpr typename learned_index<Key>::size_type learned_index<Key>::internal_epsilon;
+
+#endif //LEARNED_INDEX_HEADER
@@ -0,0 +1,278 @@
+#ifndef LRU_CACHE_HEADER
+#define LRU_CACHE_HEADER
+
+#include "my_vector.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+///A fixed-capacity least-recently-used cache that allocates nothing after construction.
+///Entries live in a `my_vector` reserved up front, and are linked in recency order
+///by 32-bit indices rather than pointers. Keys are found through an open-addressing
+///index of entry numbers, at most half full, using backward-shift deletion so that
+///it never fills with tombstones.
+///`get`, `put`, `erase` and eviction are all O(1).
+template<typename K, typename V, typename Hash = std::hash<K>, typename KeyEqual = std::equal_to<K>>
+class lru_cache
+{
+public:
+	using key_type = K;
+	using mapped_type = V;
+	using size_type = std::size_t;
+
+	///Creates a cache holding up to `capacity` entries.
+	explicit lru_cache(size_type capacity, const Hash &hash = Hash(), const KeyEqual &equal = KeyEqual())
+		: hash_(hash), equal_(equal), capacity_(capacity)
+	{
+		if (capacity == 0 || capacity >= npos / 2)
+			throw std::length_error("lru_cache: bad capacity");
+
+		size_type slot_count = 2;
+		while (slot_count < capacity * 2)
+			slot_count *= 2;
+
+		entries_.reserve(capacity);
+		index_ = my_vector<std::uint32_t>(slot_count, npos);
+	}
+
+	size_type size() const noexcept { return size_; }
+	size_type capacity() const noexcept { return capacity_; }
+	bool empty() const noexcept { return size_ == 0; }
+
+	///The bytes of storage owned by the cache, all of it allocated by the constructor.
+	size_type memory_bytes() const noexcept
+	{
+		return entries_.capacity() * sizeof(entry) + index_.capacity() * sizeof(std::uint32_t);
+	}
+
+	///Returns the value for `key` and marks it most recently used, or NULL if it is not cached.
+	V *get(const K &key)
+	{
+		auto slot = find_slot(key, hash_(key));
+		if (index_[slot] == npos)
+			return nullptr;
+
+		auto ix = index_[slot];
+		move_to_front(ix);
+		return &entries_[ix].value;
+	}
+
+	///Returns the value for `key` without changing its recency, or NULL if it is not cached.
+	const V *peek(const K &key) const
+	{
+		auto ix = index_[find_slot(key, hash_(key))];
+		return ix == npos ? nullptr : &entries_[ix].value;
+	}
+
+	bool contains(const K &key) const { return peek(key) != nullptr; }
+
+	///Caches `value` for `key` as the most recently used entry.
+	///If the cache is full, the least recently used entry is evicted and its storage reused.
+	///Returns the stored value.
+	template<typename KeyArg, typename ValueArg>
+	V &put(KeyArg &&key, ValueArg &&value)
+	{
+		auto hash = hash_(key);
+		auto slot = find_slot(key, hash);
+		if (index_[slot] != npos)
+		{
+			auto ix = index_[slot];
+			entries_[ix].value = std::forward<ValueArg>(value);
+			move_to_front(ix);
+			return entries_[ix].value;
+		}
+
+		std::uint32_t ix;
+		if (free_ == npos && entries_.size() < capacity_)
+		{
+			ix = std::uint32_t(entries_.size());
+			entries_.emplace_back(std::forward<KeyArg>(key), std::forward<ValueArg>(value));
+		}
+		else
+		{
+			bool evicted = free_ == npos;
+			if (!evicted)
+			{
+				//Reuse an erased entry.
+				ix = free_;
+				free_ = entries_[ix].next;
+			}
+			else
+			{
+				//Evict the least recently used entry, and overwrite it in place.
+				ix = tail_;
+				unlink(ix);
+				remove_slot(find_slot(entries_[ix].key, entries_[ix].hash));
+				--size_;
+			}
+
+			//The entry is now in neither the recency list, the index nor the free list.
+			//If storing the new key and value throws, it goes on the free list rather than being lost.
+			try
+			{
+				entries_[ix].key = std::forward<KeyArg>(key);
+				entries_[ix].value = std::forward<ValueArg>(value);
+				if (evicted)
+					slot = find_slot(entries_[ix].key, hash);
+			}
+			catch (...)
+			{
+				entries_[ix].next = free_;
+				free_ = ix;
+				throw;
+			}
+		}
+
+		entries_[ix].hash = hash;
+		index_[slot] = ix;
+		link_front(ix);
+		++size_;
+		return entries_[ix].value;
+	}
+
+	///Removes `key` from the cache, returning false if it was not cached.
+	///The entry's storage is kept for reuse; its key and value are not destroyed until overwritten.
+	bool erase(const K &key)
+	{
+		auto slot = find_slot(key, hash_(key));
+		auto ix = index_[slot];
+		if (ix == npos)
+			return false;
+
+		unlink(ix);
+		remove_slot(slot);
+		entries_[ix].next = free_;
+		free_ = ix;
+		--size_;
+		return true;
+	}
+
+	///Removes every entry, destroying their keys and values.
+	void clear() noexcept
+	{
+		entries_.clear();
+		for (auto &slot : index_)
+			slot = npos;
+		head_ = tail_ = free_ = npos;
+		size_ = 0;
+	}
+
+	///Calls `func(key, value)` for every entry, from most to least recently used.
+	template<typename Func>
+	void for_each(Func &&func) const
+	{
+		for (auto ix = head_; ix != npos; ix = entries_[ix].next)
+			func(entries_[ix].key, entries_[ix].value);
+	}
+
+private:
+	static constexpr std::uint32_t npos = std::numeric_limits<std::uint32_t>::max();
+
+	struct entry
+	{
+		template<typename KeyArg, typename ValueArg>
+		entry(KeyArg &&key, ValueArg &&value)
+			: key(std::forward<KeyArg>(key)), value(std::forward<ValueArg>(value))
+		{}
+
+		K key;
+		V value;
+		size_type hash = 0;
+		//Recency neighbours; `next` also links the free list.
+		std::uint32_t prev = npos;
+		std::uint32_t next = npos;
+	};
+
+	Hash hash_;
+	KeyEqual equal_;
+	size_type capacity_;
+	size_type size_ = 0;
+	my_vector<entry> entries_;
+	//Entry numbers, or `npos` for an empty slot.
+	my_vector<std::uint32_t> index_;
+	//Most and least recently used entries, and the first erased entry.
+	std::uint32_t head_ = npos;
+	std::uint32_t tail_ = npos;
+	std::uint32_t free_ = npos;
+
+	size_type mask() const noexcept { return index_.size() - 1; }
+
+	//Returns the slot holding `key`, or the empty slot that ends its probe sequence.
+	size_type find_slot(const K &key, size_type hash) const
+	{
+		auto slot = hash & mask();
+		while (index_[slot] != npos)
+		{
+			auto &curr = entries_[index_[slot]];
+			if (curr.hash == hash && equal_(curr.key, key))
+				return slot;
+			slot = (slot + 1) & mask();
+		}
+		return slot;
+	}
+
+	//Empties `slot`, shifting later entries of the probe run back so that lookups still find them.
+	void remove_slot(size_type slot) noexcept
+	{
+		auto hole = slot;
+		auto curr = slot;
+		while (true)
+		{
+			curr = (curr + 1) & mask();
+			if (index_[curr] == npos)
+				break;
+
+			//An entry may fill the hole only if the hole lies between its home slot and where it is now.
+			auto home = entries_[index_[curr]].hash & mask();
+			if (((curr - home) & mask()) >= ((curr - hole) & mask()))
+			{
+				index_[hole] = index_[curr];
+				hole = curr;
+			}
+		}
+		index_[hole] = npos;
+	}
+
+	void unlink(std::uint32_t ix) noexcept
+	{
+		auto &curr = entries_[ix];
+		if (curr.prev != npos)
+			entries_[curr.prev].next = curr.next;
+		else
+			head_ = curr.next;
+
+		if (curr.next != npos)
+			entries_[curr.next].prev = curr.prev;
+		else
+			tail_ = curr.prev;
+	}
+
+	void link_front(std::uint32_t ix) noexcept
+	{
+		auto &curr = entries_[ix];
+		curr.prev = npos;
+		curr.next = head_;
+		if (head_ != npos)
+			entries_[head_].prev = ix;
+		head_ = ix;
+		if (tail_ == npos)
+			tail_ = ix;
+	}
+
+	void move_to_front(std::uint32_t ix) noexcept
+	{
+		if (head_ == ix)
+			return;
+
+		unlink(ix);
+		link_front(ix);
+	}
+};
+
+template<typename K, typename V, typename Hash, typename KeyEqual>
+constexpr std::uint32_t lru_cache<K, V, Hash, KeyEqual>::npos;
+
+#endif //LRU_CACHE_HEADER
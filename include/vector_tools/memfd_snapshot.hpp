@@ -0,0 +1,402 @@
+#ifndef MEMFD_SNAPSHOT_HEADER
+#define MEMFD_SNAPSHOT_HEADER
+
+#if !defined(__linux__)
+#error "memfd_snapshot requires Linux (memfd_create, mmap and /proc/self/pagemap)."
+#endif
+
+#include "my_vector.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <unistd.h>
+
+namespace detail
+{
+	//The first page of each buffer's memfd. The elements start on the page after it.
+	struct memfd_buffer_header
+	{
+		int fd;
+		std::size_t data_bytes;
+
+		//True while the live mapping of the elements is private, so that writes to it
+		//leave the memfd as it was when the last snapshot was taken. Only the writer uses this.
+		bool frozen;
+
+		//True while a snapshot of the memfd is in use. Cleared by the snapshot, from any thread.
+		std::atomic<bool> snapshot_held;
+	};
+
+	inline std::size_t memfd_page_size() noexcept
+	{
+		static const auto size = std::size_t(::sysconf(_SC_PAGESIZE));
+		return size;
+	}
+
+	[[noreturn]] inline void throw_memfd_error(const char *what)
+	{
+		throw std::system_error(errno, std::generic_category(), what);
+	}
+
+	inline memfd_buffer_header *memfd_header_of(const void *data) noexcept
+	{
+		return reinterpret_cast<memfd_buffer_header*>(
+			const_cast<char*>(static_cast<const char*>(data)) - memfd_page_size());
+	}
+
+	//Maps the elements of the buffer over their current address, shared with the memfd or private to us.
+	inline void memfd_remap_data(const memfd_buffer_header &header, void *data, int sharing)
+	{
+		if (header.data_bytes == 0)
+			return;
+
+		auto mapped = ::mmap(data, header.data_bytes, PROT_READ | PROT_WRITE, sharing | MAP_FIXED,
+			header.fd, off_t(memfd_page_size()));
+		if (mapped == MAP_FAILED)
+			throw_memfd_error("mmap");
+	}
+
+	inline void memfd_write_pages(const memfd_buffer_header &header, const char *data, std::size_t offset, std::size_t bytes)
+	{
+		auto file_offset = off_t(memfd_page_size() + offset);
+		while (bytes != 0)
+		{
+			auto written = ::pwrite(header.fd, data + offset, bytes, file_offset);
+			if (written < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				throw_memfd_error("pwrite");
+			}
+			offset += std::size_t(written);
+			file_offset += written;
+			bytes -= std::size_t(written);
+		}
+	}
+
+	//Writes back to the memfd the pages of the private live mapping that have been written since it was frozen.
+	//Those are the pages that `/proc/self/pagemap` no longer shows as file pages. Without access to it,
+	//every page is written back.
+	inline void memfd_write_back(const memfd_buffer_header &header, const char *data)
+	{
+		auto page = memfd_page_size();
+		auto pages = header.data_bytes / page;
+
+		int pagemap = ::open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+		if (pagemap < 0)
+		{
+			memfd_write_pages(header, data, 0, header.data_bytes);
+			return;
+		}
+
+		struct closer
+		{
+			int fd;
+			~closer() { ::close(fd); }
+		} close_pagemap{ pagemap };
+
+		//Entry bits: 63 present, 62 swapped, 61 file page or shared.
+		constexpr std::uint64_t present = std::uint64_t(1) << 63;
+		constexpr std::uint64_t swapped = std::uint64_t(1) << 62;
+		constexpr std::uint64_t file_page = std::uint64_t(1) << 61;
+
+		constexpr std::size_t batch = 4096;
+		std::uint64_t entries[batch];
+		auto first_entry = reinterpret_cast<std::uintptr_t>(data) / page;
+
+		//Consecutive dirty pages are written together.
+		std::size_t run_start = 0;
+		std::size_t run_pages = 0;
+		for (std::size_t first = 0; first < pages; first += batch)
+		{
+			auto count = std::min(batch, pages - first);
+			auto bytes = count * sizeof(std::uint64_t);
+			auto read = ::pread(pagemap, entries, bytes, off_t((first_entry + first) * sizeof(std::uint64_t)));
+			if (read != ssize_t(bytes))
+			{
+				memfd_write_pages(header, data, 0, header.data_bytes);
+				return;
+			}
+
+			for (std::size_t ix = 0; ix != count; ++ix)
+			{
+				auto entry = entries[ix];
+				bool dirty = (entry & (present | swapped)) != 0 && (entry & file_page) == 0;
+				if (dirty && run_pages != 0 && run_start + run_pages == first + ix)
+				{
+					++run_pages;
+					continue;
+				}
+
+				if (dirty)
+				{
+					if (run_pages != 0)
+						memfd_write_pages(header, data, run_start * page, run_pages * page);
+					run_start = first + ix;
+					run_pages = 1;
+				}
+			}
+		}
+
+		if (run_pages != 0)
+			memfd_write_pages(header, data, run_start * page, run_pages * page);
+	}
+}
+
+///An allocator that puts each buffer in its own memfd, mapped shared, so that `take_memfd_snapshot`
+///can freeze a vector's contents without copying them. Allocations are whole pages, plus one page
+///at the front for bookkeeping; it is meant for large vectors of trivially copyable data.
+template<typename T>
+class memfd_allocator
+{
+public:
+	using value_type = T;
+
+	static_assert(std::is_trivially_copyable<T>::value, "memfd_allocator is for trivially copyable types.");
+
+	memfd_allocator() noexcept = default;
+
+	template<typename U>
+	memfd_allocator(const memfd_allocator<U> &) noexcept {}
+
+	T *allocate(std::size_t count)
+	{
+		auto page = detail::memfd_page_size();
+		auto data_bytes = (count * sizeof(T) + page - 1) / page * page;
+
+		int fd = ::memfd_create("my_vector", MFD_CLOEXEC);
+		if (fd < 0)
+			detail::throw_memfd_error("memfd_create");
+
+		if (::ftruncate(fd, off_t(page + data_bytes)) != 0)
+		{
+			auto error = errno;
+			::close(fd);
+			errno = error;
+			detail::throw_memfd_error("ftruncate");
+		}
+
+		auto base = ::mmap(nullptr, page + data_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (base == MAP_FAILED)
+		{
+			auto error = errno;
+			::close(fd);
+			errno = error;
+			detail::throw_memfd_error("mmap");
+		}
+
+		auto header = new(base) detail::memfd_buffer_header;
+		header->fd = fd;
+		header->data_bytes = data_bytes;
+		header->frozen = false;
+		header->snapshot_held.store(false);
+		return reinterpret_cast<T*>(static_cast<char*>(base) + page);
+	}
+
+	///A snapshot of the buffer keeps its own descriptor and mapping, so it outlives the deallocation.
+	void deallocate(T *ptr, std::size_t) noexcept
+	{
+		auto header = detail::memfd_header_of(ptr);
+		auto fd = header->fd;
+		::munmap(header, detail::memfd_page_size() + header->data_bytes);
+		::close(fd);
+	}
+
+	friend bool operator==(const memfd_allocator &, const memfd_allocator &) noexcept { return true; }
+	friend bool operator!=(const memfd_allocator &, const memfd_allocator &) noexcept { return false; }
+};
+
+///A read-only, point-in-time copy of a `memfd_allocator` vector's elements, made by `take_memfd_snapshot`.
+///It maps the frozen memfd, so it costs no copying to make; the live vector pays instead,
+///one page copy for each page it writes while the snapshot is held.
+///It may be read, and destroyed, on any thread.
+template<typename T>
+class memfd_snapshot
+{
+public:
+	memfd_snapshot() noexcept = default;
+
+	memfd_snapshot(memfd_snapshot &&other) noexcept
+		: fd_(std::exchange(other.fd_, -1))
+		, base_(std::exchange(other.base_, nullptr))
+		, map_bytes_(std::exchange(other.map_bytes_, 0))
+		, size_(std::exchange(other.size_, 0))
+	{}
+
+	memfd_snapshot &operator=(memfd_snapshot &&other) noexcept
+	{
+		if (this != &other)
+		{
+			reset();
+			fd_ = std::exchange(other.fd_, -1);
+			base_ = std::exchange(other.base_, nullptr);
+			map_bytes_ = std::exchange(other.map_bytes_, 0);
+			size_ = std::exchange(other.size_, 0);
+		}
+		return *this;
+	}
+
+	~memfd_snapshot()
+	{
+		reset();
+	}
+
+	const T *data() const noexcept { return base_ ? reinterpret_cast<const T*>(base_ + detail::memfd_page_size()) : nullptr; }
+	std::size_t size() const noexcept { return size_; }
+	bool empty() const noexcept { return size_ == 0; }
+
+	const T *begin() const noexcept { return data(); }
+	const T *end() const noexcept { return data() + size_; }
+	const T &operator[](std::size_t ix) const noexcept { return data()[ix]; }
+
+	///Writes the elements to `out_fd` at its current offset. The bytes go straight from the memfd
+	///with `sendfile`, without passing through user space, where the kernel allows it.
+	void write_to(int out_fd) const
+	{
+		auto offset = off_t(detail::memfd_page_size());
+		auto remaining = size_ * sizeof(T);
+		while (remaining != 0)
+		{
+			auto sent = ::sendfile(out_fd, fd_, &offset, remaining);
+			if (sent < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				if (errno == EINVAL || errno == ENOSYS)
+					return write_mapped(out_fd, offset, remaining);
+				detail::throw_memfd_error("sendfile");
+			}
+			if (sent == 0)
+				return write_mapped(out_fd, offset, remaining);
+			remaining -= std::size_t(sent);
+		}
+	}
+
+	///Releases the snapshot, letting the vector take another.
+	void reset() noexcept
+	{
+		if (!base_)
+			return;
+
+		reinterpret_cast<detail::memfd_buffer_header*>(base_)->snapshot_held.store(false, std::memory_order_release);
+		::munmap(base_, map_bytes_);
+		::close(fd_);
+		fd_ = -1;
+		base_ = nullptr;
+		map_bytes_ = 0;
+		size_ = 0;
+	}
+
+private:
+	int fd_ = -1;
+	char *base_ = nullptr;
+	std::size_t map_bytes_ = 0;
+	std::size_t size_ = 0;
+
+	memfd_snapshot(int fd, char *base, std::size_t map_bytes, std::size_t size) noexcept
+		: fd_(fd), base_(base), map_bytes_(map_bytes), size_(size)
+	{}
+
+	void write_mapped(int out_fd, off_t offset, std::size_t remaining) const
+	{
+		auto bytes = base_ + offset;
+		while (remaining != 0)
+		{
+			auto written = ::write(out_fd, bytes, remaining);
+			if (written < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				detail::throw_memfd_error("write");
+			}
+			bytes += written;
+			remaining -= std::size_t(written);
+		}
+	}
+
+	template<typename U>
+	friend memfd_snapshot<U> take_memfd_snapshot(my_vector<U, memfd_allocator<U>> &vec);
+};
+
+///Takes a snapshot of `vec`'s elements without copying them, for reading on another thread while `vec` goes on changing.
+///The live mapping of `vec`'s buffer is remapped privately over itself, so its memfd stops changing
+///and becomes the snapshot; each page of `vec` is then copied the first time it is written.
+///Before freezing again, the pages written since the last snapshot are written back to the memfd.
+///
+///Call this from the thread that writes `vec`, or while nothing does. Only one snapshot of a buffer
+///can be held at a time: throws `std::logic_error` if the last one has not been released.
+template<typename T>
+memfd_snapshot<T> take_memfd_snapshot(my_vector<T, memfd_allocator<T>> &vec)
+{
+	if (vec.capacity() == 0)
+		return memfd_snapshot<T>();
+
+	auto data = reinterpret_cast<char*>(vec.data());
+	auto &header = *detail::memfd_header_of(data);
+	if (header.snapshot_held.load(std::memory_order_acquire))
+		throw std::logic_error("take_memfd_snapshot: the last snapshot of this vector is still held");
+
+	if (header.frozen)
+		detail::memfd_write_back(header, data);
+
+	//A fresh private mapping drops the pages copied since the last snapshot; the memfd now has them.
+	detail::memfd_remap_data(header, data, MAP_PRIVATE);
+	header.frozen = true;
+
+	int fd = ::fcntl(header.fd, F_DUPFD_CLOEXEC, 0);
+	if (fd < 0)
+		detail::throw_memfd_error("fcntl");
+
+	auto page = detail::memfd_page_size();
+	auto map_bytes = page + header.data_bytes;
+	auto base = ::mmap(nullptr, map_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (base == MAP_FAILED)
+	{
+		auto error = errno;
+		::close(fd);
+		errno = error;
+		detail::throw_memfd_error("mmap");
+	}
+
+	//Only the header needs to be written through the snapshot's mapping.
+	if (header.data_bytes != 0)
+		::mprotect(static_cast<char*>(base) + page, header.data_bytes, PROT_READ);
+
+	header.snapshot_held.store(true, std::memory_order_release);
+	return memfd_snapshot<T>(fd, static_cast<char*>(base), map_bytes, vec.size());
+}
+
+///Writes the pages changed since the last snapshot back to `vec`'s memfd and maps it shared again,
+///freeing the private copies. For when no snapshot will be needed for a while.
+///Throws `std::logic_error` if a snapshot is still held.
+template<typename T>
+void thaw_memfd_vector(my_vector<T, memfd_allocator<T>> &vec)
+{
+	if (vec.capacity() == 0)
+		return;
+
+	auto data = reinterpret_cast<char*>(vec.data());
+	auto &header = *detail::memfd_header_of(data);
+	if (!header.frozen)
+		return;
+
+	if (header.snapshot_held.load(std::memory_order_acquire))
+		throw std::logic_error("thaw_memfd_vector: a snapshot of this vector is still held");
+
+	detail::memfd_write_back(header, data);
+	detail::memfd_remap_data(header, data, MAP_SHARED);
+	header.frozen = false;
+}
+
+#endif //MEMFD_SNAPSHOT_HEADER
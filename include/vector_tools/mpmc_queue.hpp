@@ -0,0 +1,245 @@
+#ifndef MPMC_QUEUE_HEADER
+#define MPMC_QUEUE_HEADER
+
+#include "my_vector.hpp"
+#include "vector_tools.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace detail
+{
+	constexpr std::size_t cache_line_size = 64;
+
+	//An atomic index on a cache line of its own.
+	struct padded_index
+	{
+		char pad_before[cache_line_size];
+		std::atomic<std::size_t> value;
+		char pad_after[cache_line_size - sizeof(std::atomic<std::size_t>)];
+	};
+}
+
+///A bounded, lock-free, multi-producer/multi-consumer queue.
+///Each slot carries a sequence number that tells producers and consumers whose turn it is,
+///so threads only contend on the two position counters, each on its own cache line.
+///Batch operations claim a run of consecutive slots with a single compare-exchange.
+///`T` must be nothrow move constructible, so that a claimed slot is always filled.
+template<typename T, typename Alloc = std::allocator<T>>
+class mpmc_queue
+{
+public:
+	static_assert(std::is_nothrow_move_constructible<T>::value,
+		"Queue elements must be nothrow move constructible.");
+
+	using value_type = T;
+	using size_type = std::size_t;
+	using allocator_type = Alloc;
+
+	///Creates a queue that holds up to `capacity` elements, rounded up to a power of two.
+	explicit mpmc_queue(size_type capacity, const Alloc &alloc = Alloc())
+		: alloc_(alloc), slot_alloc_(alloc_)
+	{
+		size_type rounded = 2;
+		while (rounded < capacity)
+			rounded *= 2;
+
+		mask_ = rounded - 1;
+		slots_ = std::allocator_traits<slot_alloc_type>::allocate(slot_alloc_, rounded);
+		vector_tools::emplace_construct_count(slots_, rounded, slot_alloc_);
+		for (size_type ix = 0; ix < rounded; ++ix)
+			slots_[ix].sequence.store(ix, std::memory_order_relaxed);
+
+		head_.value.store(0, std::memory_order_relaxed);
+		tail_.value.store(0, std::memory_order_relaxed);
+	}
+
+	mpmc_queue(const mpmc_queue &) = delete;
+	mpmc_queue &operator=(const mpmc_queue &) = delete;
+
+	~mpmc_queue()
+	{
+		//Destroy the elements still queued, then the slots themselves.
+		auto head = head_.value.load(std::memory_order_relaxed);
+		for (auto pos = tail_.value.load(std::memory_order_relaxed); pos != head; ++pos)
+			std::allocator_traits<Alloc>::destroy(alloc_, slots_[pos & mask_].value());
+
+		vector_tools::destroy_range(slots_, slots_ + capacity(), slot_alloc_);
+		std::allocator_traits<slot_alloc_type>::deallocate(slot_alloc_, slots_, capacity());
+	}
+
+	size_type capacity() const noexcept { return mask_ + 1; }
+
+	///The number of queued elements. Only a snapshot while other threads are active.
+	size_type size_approx() const noexcept
+	{
+		auto tail = tail_.value.load(std::memory_order_relaxed);
+		auto head = head_.value.load(std::memory_order_relaxed);
+		return head > tail ? head - tail : 0;
+	}
+
+	///Constructs an element from `args` in the queue, if there is room.
+	///The element is constructed before a slot is claimed, so a throwing constructor
+	///leaves the queue untouched.
+	template<typename ...Args>
+	bool try_emplace(Args &&...args)
+	{
+		T value(std::forward<Args>(args)...);
+		return try_push(std::move(value));
+	}
+
+	bool try_push(const T &value)
+	{
+		return try_emplace(value);
+	}
+
+	bool try_push(T &&value) noexcept
+	{
+		size_type pos;
+		if (claim(head_, 0, 1, pos) == 0)
+			return false;
+
+		auto &target = slots_[pos & mask_];
+		std::allocator_traits<Alloc>::construct(alloc_, target.value(), std::move(value));
+		target.sequence.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	///Moves the front element into `out`, if there is one.
+	///If the move assignment throws, the element is dropped, so that its slot is still released.
+	bool try_pop(T &out) noexcept(std::is_nothrow_move_assignable<T>::value)
+	{
+		size_type pos;
+		if (claim(tail_, 1, 1, pos) == 0)
+			return false;
+
+		claimed_slots claimed{ *this, pos, pos + 1 };
+		out = std::move(*slots_[pos & mask_].value());
+		return true;
+	}
+
+	///Copies as many of the `count` elements at `first` as there are free slots, in order.
+	///All of them are claimed with one compare-exchange.
+	///Returns the number of elements pushed.
+	size_type try_push_bulk(const T *first, size_type count) noexcept
+	{
+		static_assert(std::is_nothrow_copy_constructible<T>::value,
+			"Bulk pushes copy into claimed slots, so copying must not throw.");
+
+		size_type pos;
+		count = claim(head_, 0, count, pos);
+		for (size_type ix = 0; ix < count; ++ix)
+		{
+			auto &target = slots_[(pos + ix) & mask_];
+			std::allocator_traits<Alloc>::construct(alloc_, target.value(), first[ix]);
+			target.sequence.store(pos + ix + 1, std::memory_order_release);
+		}
+
+		return count;
+	}
+
+	///Moves up to `max_count` elements onto the end of `out`, claiming them with one compare-exchange.
+	///`out` is grown at most once, geometrically, and only if something was popped.
+	///If growing it throws, the claimed elements are dropped, so that their slots are still released.
+	///Returns the number of elements popped.
+	size_type try_pop_bulk(my_vector<T> &out, size_type max_count)
+	{
+		size_type pos;
+		auto count = claim(tail_, 1, max_count, pos);
+		if (count == 0)
+			return 0;
+
+		claimed_slots claimed{ *this, pos, pos + count };
+		if (out.capacity() - out.size() < count)
+			out.reserve(std::max(out.size() + count, out.capacity() + out.capacity() / 2));
+
+		for (; claimed.first != claimed.last; ++claimed.first)
+		{
+			auto &source = slots_[claimed.first & mask_];
+			out.emplace_back(std::move(*source.value()));
+			release(source, claimed.first);
+		}
+
+		return count;
+	}
+
+private:
+	struct slot
+	{
+		std::atomic<size_type> sequence;
+		typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+
+		T *value() noexcept { return reinterpret_cast<T*>(&storage); }
+	};
+
+	using slot_alloc_type = typename std::allocator_traits<Alloc>::template rebind_alloc<slot>;
+
+	Alloc alloc_;
+	slot_alloc_type slot_alloc_;
+	slot *slots_;
+	size_type mask_;
+	//Next position to write, and next position to read.
+	detail::padded_index head_;
+	detail::padded_index tail_;
+
+	//Claims up to `max_count` consecutive positions from `index`, returning how many were claimed.
+	//A slot at position `p` is ready once its sequence equals `p + lag`:
+	//`lag` is 0 for producers, which need an empty slot, and 1 for consumers, which need a full one.
+	size_type claim(detail::padded_index &index, size_type lag, size_type max_count, size_type &pos) noexcept
+	{
+		pos = index.value.load(std::memory_order_relaxed);
+		while (max_count != 0)
+		{
+			size_type ready = 0;
+			while (ready < max_count && ready <= mask_ &&
+				slots_[(pos + ready) & mask_].sequence.load(std::memory_order_acquire) == pos + ready + lag)
+			{
+				++ready;
+			}
+
+			if (ready == 0)
+			{
+				//Either the queue is full/empty, or another thread claimed `pos` first.
+				auto seq = slots_[pos & mask_].sequence.load(std::memory_order_acquire);
+				if (std::ptrdiff_t(seq - (pos + lag)) < 0)
+					return 0;
+
+				pos = index.value.load(std::memory_order_relaxed);
+				continue;
+			}
+
+			if (index.value.compare_exchange_weak(pos, pos + ready, std::memory_order_relaxed))
+				return ready;
+		}
+
+		return 0;
+	}
+
+	//Destroys the element at position `pos` and hands the slot to the producer one lap ahead.
+	void release(slot &source, size_type pos) noexcept
+	{
+		std::allocator_traits<Alloc>::destroy(alloc_, source.value());
+		source.sequence.store(pos + mask_ + 1, std::memory_order_release);
+	}
+
+	//Positions `[first, last)` claimed by a consumer and not yet released.
+	//Releases them on destruction, so that an exception cannot leave them claimed for good.
+	struct claimed_slots
+	{
+		mpmc_queue &queue;
+		size_type first;
+		size_type last;
+
+		~claimed_slots()
+		{
+			for (; first != last; ++first)
+				queue.release(queue.slots_[first & queue.mask_], first);
+		}
+	};
+};
+
+#endif //MPMC_QUEUE_HEADER
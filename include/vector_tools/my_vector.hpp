@@ -9,19 +9,22 @@
 #include <limits>
 #include <initializer_list>
 #include <algorithm>
+#include <array>
+#include <functional>
+#include <type_traits>
 
 namespace detail
 {
 	template<typename Alloc>
 	struct allocator_data : public Alloc
 	{
-		allocator_data() : Alloc() {}
+		VECTOR_TOOLS_CONSTEXPR allocator_data() : Alloc() {}
 
-		allocator_data(const Alloc &alloc) : Alloc(alloc) {}
-		allocator_data(Alloc &&alloc) : Alloc(std::move(alloc)) {}
+		VECTOR_TOOLS_CONSTEXPR allocator_data(const Alloc &alloc) : Alloc(alloc) {}
+		VECTOR_TOOLS_CONSTEXPR allocator_data(Alloc &&alloc) : Alloc(std::move(alloc)) {}
 
-		Alloc &get_alloc() { return static_cast<Alloc&>(*this); }
-		const Alloc &get_alloc() const { return static_cast<Alloc&>(*this); }
+		VECTOR_TOOLS_CONSTEXPR Alloc &get_alloc() { return static_cast<Alloc&>(*this); }
+		VECTOR_TOOLS_CONSTEXPR const Alloc &get_alloc() const { return static_cast<const Alloc&>(*this); }
 	};
 }
 
@@ -49,11 +52,11 @@ public:
 	using reverse_iterator = std::reverse_iterator<iterator>;
 	using const_reverse_iterator = std::reverse_iterator<const_iterator>;
 
-	my_vector() noexcept(noexcept(Alloc())) : my_vector(Alloc()) {}
-	explicit my_vector(const Alloc& alloc) noexcept
+	VECTOR_TOOLS_CONSTEXPR my_vector() noexcept(noexcept(Alloc())) : my_vector(Alloc()) {}
+	VECTOR_TOOLS_CONSTEXPR explicit my_vector(const Alloc& alloc) noexcept
 		: alloc_data(alloc), first_(nullptr), last_(nullptr), end_(nullptr) {}
 
-	explicit my_vector(size_type count, const Alloc& alloc = Alloc())
+	VECTOR_TOOLS_CONSTEXPR explicit my_vector(size_type count, const Alloc& alloc = Alloc())
 		: my_vector(alloc)
 	{
 		if (count != 0)
@@ -65,7 +68,7 @@ public:
 		}
 	}
 
-	explicit my_vector(size_type count, const T &value, const Alloc& alloc = Alloc())
+	VECTOR_TOOLS_CONSTEXPR explicit my_vector(size_type count, const T &value, const Alloc& alloc = Alloc())
 		: my_vector(alloc)
 	{
 		if (count != 0)
@@ -78,11 +81,11 @@ public:
 		}
 	}
 
-	my_vector(const my_vector& other)
-		: my_vector(other, std::allocator_traits<Alloc>::select_on_container_copy_construction(other.my_allocator))
+	VECTOR_TOOLS_CONSTEXPR my_vector(const my_vector& other)
+		: my_vector(other, std::allocator_traits<Alloc>::select_on_container_copy_construction(other.get_alloc()))
 	{}
 
-	my_vector(const my_vector& other, const Alloc& alloc)
+	VECTOR_TOOLS_CONSTEXPR my_vector(const my_vector& other, const Alloc& alloc)
 		: my_vector(alloc)
 	{
 		auto cap = other.size(); //Perhaps increase capacity.
@@ -93,7 +96,7 @@ public:
 		end_ = first_ + cap;
 	}
 
-	my_vector(my_vector &&other) noexcept
+	VECTOR_TOOLS_CONSTEXPR my_vector(my_vector &&other) noexcept
 		: alloc_data(std::move(other.get_alloc()))
 		, first_(other.first_)
 		, last_(other.last_)
@@ -102,7 +105,7 @@ public:
 		other.nullify();
 	}
 
-	my_vector(my_vector&& other, const Alloc& alloc)
+	VECTOR_TOOLS_CONSTEXPR my_vector(my_vector&& other, const Alloc& alloc)
 		: my_vector(alloc)
 	{
 		if (get_alloc() == other.get_alloc())
@@ -123,7 +126,21 @@ public:
 		}
 	}
 
-	my_vector(std::initializer_list<T> init, const Alloc &alloc = Alloc())
+	template<typename ForwardIt, typename = std::enable_if_t<std::is_base_of<std::forward_iterator_tag,
+		typename std::iterator_traits<ForwardIt>::iterator_category>::value>>
+	VECTOR_TOOLS_CONSTEXPR my_vector(ForwardIt first, ForwardIt last, const Alloc &alloc = Alloc())
+		: my_vector(alloc)
+	{
+		auto cap = size_type(std::distance(first, last));
+		if (cap != 0)
+		{
+			first_ = std::allocator_traits<Alloc>::allocate(get_alloc(), cap);
+			last_ = vector_tools::copy_insert_range(first_, get_alloc(), first, last);
+			end_ = first_ + cap;
+		}
+	}
+
+	VECTOR_TOOLS_CONSTEXPR my_vector(std::initializer_list<T> init, const Alloc &alloc = Alloc())
 		: my_vector(alloc)
 	{
 		auto cap = init.size();
@@ -134,12 +151,20 @@ public:
 		end_ = first_ + cap;
 	}
 
-	~my_vector()
+	///Evaluates an element-wise expression (see `vector_expr.hpp`) into a new vector.
+	template<typename Expr, typename = typename Expr::is_vector_expression>
+	my_vector(const Expr &expr, const Alloc &alloc = Alloc())
+		: my_vector(alloc)
+	{
+		expr.assign_to(*this);
+	}
+
+	VECTOR_TOOLS_CONSTEXPR ~my_vector()
 	{
 		clear_and_destroy();
 	}
 
-	my_vector &operator=(const my_vector &other)
+	VECTOR_TOOLS_CONSTEXPR my_vector &operator=(const my_vector &other)
 	{
 		if (this == &other)
 			return *this;
@@ -160,12 +185,12 @@ public:
 		ensure_space_exact(other.size());
 
 		//We already deleted all our stuff, so copy-construct away.
-		vector_tools::copy_insert_range(first_, get_alloc(), other.begin(), other.end());
+		last_ = vector_tools::copy_insert_range(first_, get_alloc(), other.begin(), other.end());
 
 		return *this;
 	}
 
-	my_vector &operator=(my_vector &&other)
+	VECTOR_TOOLS_CONSTEXPR my_vector &operator=(my_vector &&other)
 	{
 		if (this == &other)
 			return *this;
@@ -185,46 +210,55 @@ public:
 			//Must move individual elements.
 			clear();
 			ensure_space_exact(other.size());
-			vector_tools::safemove_insert_range(first_, get_alloc(), other.begin(), other.end());
+			last_ = vector_tools::safemove_insert_range(first_, get_alloc(), other.begin(), other.end());
 		}
 
 		return *this;
 	}
 
-	reference at(size_type ix)
+	///Evaluates an element-wise expression (see `vector_expr.hpp`) straight into this vector's storage,
+	///reusing its capacity. The expression may refer to this vector itself.
+	template<typename Expr, typename = typename Expr::is_vector_expression>
+	my_vector &operator=(const Expr &expr)
+	{
+		expr.assign_to(*this);
+		return *this;
+	}
+
+	VECTOR_TOOLS_CONSTEXPR reference at(size_type ix)
 	{
 		if (ix < size())
 			return first_[ix];
 		throw std::out_of_range("Out of range");
 	}
 
-	const_reference at(size_type ix) const
+	VECTOR_TOOLS_CONSTEXPR const_reference at(size_type ix) const
 	{
 		if (ix < size())
 			return first_[ix];
 		throw std::out_of_range("Out of range");
 	}
 
-	reference operator[](size_type ix) { return first_[ix]; }
-	const_reference operator[](size_type ix) const { return first_[ix]; }
+	VECTOR_TOOLS_CONSTEXPR reference operator[](size_type ix) { return first_[ix]; }
+	VECTOR_TOOLS_CONSTEXPR const_reference operator[](size_type ix) const { return first_[ix]; }
 
-	reference first() { return first_[0]; }
-	const_reference first() const { return first_[0]; }
+	VECTOR_TOOLS_CONSTEXPR reference first() { return first_[0]; }
+	VECTOR_TOOLS_CONSTEXPR const_reference first() const { return first_[0]; }
 
-	reference back() { return first_[size() - 1]; }
-	const_reference back() const { return first_[size() - 1]; }
+	VECTOR_TOOLS_CONSTEXPR reference back() { return first_[size() - 1]; }
+	VECTOR_TOOLS_CONSTEXPR const_reference back() const { return first_[size() - 1]; }
 
-	T *data() { return first_; }
-	const T *data() const { return first_; }
+	VECTOR_TOOLS_CONSTEXPR T *data() { return first_; }
+	VECTOR_TOOLS_CONSTEXPR const T *data() const { return first_; }
 
-	bool empty() const noexcept { return first_ == last_; }
+	VECTOR_TOOLS_CONSTEXPR bool empty() const noexcept { return first_ == last_; }
 
-	size_type size() const noexcept { return size_type(last_ - first_); }
-	size_type max_size() const noexcept { return std::numeric_limits<difference_type>::max(); }
+	VECTOR_TOOLS_CONSTEXPR size_type size() const noexcept { return size_type(last_ - first_); }
+	VECTOR_TOOLS_CONSTEXPR size_type max_size() const noexcept { return std::numeric_limits<difference_type>::max(); }
 
-	size_type capacity() const { return size_type(end_ - first_); }
+	VECTOR_TOOLS_CONSTEXPR size_type capacity() const { return size_type(end_ - first_); }
 
-	void swap(my_vector &other) 
+	VECTOR_TOOLS_CONSTEXPR void swap(my_vector &other) 
 		noexcept(noexcept(
 		std::allocator_traits<Alloc>::propagate_on_container_swap::value
 		/*|| std::allocator_traits<Alloc>::is_always_equal::value*/))
@@ -240,28 +274,28 @@ public:
 		}
 	}
 
-	void clear() noexcept
+	VECTOR_TOOLS_CONSTEXPR void clear() noexcept
 	{
 		vector_tools::destroy_range(first_, last_, get_alloc());
 		last_ = first_;
 	}
 
-	iterator begin() { return first_; }
-	iterator end() { return last_; }
-	const_iterator begin() const { return first_; }
-	const_iterator end() const { return last_; }
-	auto cbegin() const { return begin(); }
-	auto cend() const { return end(); }
+	VECTOR_TOOLS_CONSTEXPR iterator begin() { return first_; }
+	VECTOR_TOOLS_CONSTEXPR iterator end() { return last_; }
+	VECTOR_TOOLS_CONSTEXPR const_iterator begin() const { return first_; }
+	VECTOR_TOOLS_CONSTEXPR const_iterator end() const { return last_; }
+	VECTOR_TOOLS_CONSTEXPR auto cbegin() const { return begin(); }
+	VECTOR_TOOLS_CONSTEXPR auto cend() const { return end(); }
 
-	reverse_iterator rbegin() { return reverse_iterator(last_); }
-	reverse_iterator rend() { return reverse_iterator(first_); }
-	const_reverse_iterator rbegin() const { return const_reverse_iterator(last_); }
-	const_reverse_iterator rend() const { return const_reverse_iterator(first_); }
-	auto crbegin() const { return rbegin(); }
-	auto crend() const { return rend(); }
+	VECTOR_TOOLS_CONSTEXPR reverse_iterator rbegin() { return reverse_iterator(last_); }
+	VECTOR_TOOLS_CONSTEXPR reverse_iterator rend() { return reverse_iterator(first_); }
+	VECTOR_TOOLS_CONSTEXPR const_reverse_iterator rbegin() const { return const_reverse_iterator(last_); }
+	VECTOR_TOOLS_CONSTEXPR const_reverse_iterator rend() const { return const_reverse_iterator(first_); }
+	VECTOR_TOOLS_CONSTEXPR auto crbegin() const { return rbegin(); }
+	VECTOR_TOOLS_CONSTEXPR auto crend() const { return rend(); }
 
 
-	void reserve(size_type new_cap)
+	VECTOR_TOOLS_CONSTEXPR void reserve(size_type new_cap)
 	{
 		auto cap = capacity();
 		if (cap >= new_cap)
@@ -270,7 +304,7 @@ public:
 		reallocate_storage(new_cap);
 	}
 
-	void shrink_to_fit()
+	VECTOR_TOOLS_CONSTEXPR void shrink_to_fit()
 	{
 		if (last_ == end_)
 			return;
@@ -278,7 +312,7 @@ public:
 		reallocate_storage(size());
 	}
 
-	void resize(size_type new_size)
+	VECTOR_TOOLS_CONSTEXPR void resize(size_type new_size)
 	{
 		ensure_space_exact(new_size);
 
@@ -288,7 +322,7 @@ public:
 			remove_from_end(size() - new_size);
 	}
 
-	void resize(size_type new_size, const value_type& value)
+	VECTOR_TOOLS_CONSTEXPR void resize(size_type new_size, const value_type& value)
 	{
 		ensure_space_exact(new_size);
 
@@ -298,7 +332,19 @@ public:
 			remove_from_end(size() - new_size);
 	}
 
-	iterator erase(const_iterator pos)
+	///Resizes like `resize`, but new elements are default-initialized rather than value-initialized.
+	///For trivial types that means they are left unwritten, for the caller to fill in.
+	VECTOR_TOOLS_CONSTEXPR void resize_default_init(size_type new_size)
+	{
+		ensure_space_exact(new_size);
+
+		if (new_size > size())
+			last_ = vector_tools::default_construct_count(last_, new_size - size(), get_alloc());
+		else
+			remove_from_end(size() - new_size);
+	}
+
+	VECTOR_TOOLS_CONSTEXPR iterator erase(const_iterator pos)
 	{
 		auto r_pos = const_cast<iterator>(pos);
 		auto next = r_pos + 1;
@@ -309,7 +355,7 @@ public:
 		return const_cast<iterator>(pos); //Launder this?
 	}
 
-	iterator erase(const_iterator beg, const_iterator last)
+	VECTOR_TOOLS_CONSTEXPR iterator erase(const_iterator beg, const_iterator last)
 	{
 		auto next = const_cast<iterator>(last);
 		auto new_last = vector_tools::safemove_assign_shift_left(const_cast<T*>(beg), next, last_);
@@ -319,40 +365,62 @@ public:
 		return const_cast<iterator>(beg); //Launder this?
 	}
 
-	void push_back(const T &value)
+	///Moves the elements in `beg/last` so that they are inserted before `pos`,
+	///without allocating. `pos` must not be inside `beg/last`, except at its ends.
+	///Returns an iterator to the new position of the first moved element.
+	VECTOR_TOOLS_CONSTEXPR iterator move_range(const_iterator beg, const_iterator last, const_iterator pos)
+	{
+		return vector_tools::slide(const_cast<iterator>(beg),
+			const_cast<iterator>(last), const_cast<iterator>(pos));
+	}
+
+	VECTOR_TOOLS_CONSTEXPR void push_back(const T &value)
 	{
 		if (last_ == end_)
+		{
+			//Reallocating would move `value` out from under us if it is one of our elements.
+			if (contains_address(value))
+				return push_back(T(value));
+
 			ensure_space_exact(calc_expanded_capacity());
+		}
 
 		last_ = vector_tools::emplace_construct_count(last_, 1, get_alloc(), value);
+		hint_growth();
 	}
 
-	void push_back(T &&value)
+	VECTOR_TOOLS_CONSTEXPR void push_back(T &&value)
 	{
 		if (last_ == end_)
 			ensure_space_exact(calc_expanded_capacity());
 
 		last_ = vector_tools::emplace_construct_count(last_, 1, get_alloc(), std::move(value));
+		hint_growth();
 	}
 
 	template<typename ...Args>
-	reference emplace_back(Args&&... args)
+	VECTOR_TOOLS_CONSTEXPR reference emplace_back(Args&&... args)
 	{
 		if (last_ == end_)
 			ensure_space_exact(calc_expanded_capacity());
 
 		last_ = vector_tools::emplace_construct_count(last_, 1, get_alloc(), std::forward<Args>(args)...);
+		hint_growth();
 		return *(last_ - 1);
 	}
 
-	void pop_back()
+	VECTOR_TOOLS_CONSTEXPR void pop_back()
 	{
 		vector_tools::destroy_range(last_ - 1, last_, get_alloc());
 		--last_;
 	}
 
-	iterator insert(const_iterator pos, const T &value)
+	VECTOR_TOOLS_CONSTEXPR iterator insert(const_iterator pos, const T &value)
 	{
+		//`value` may be one of our own elements, which the shift or reallocation would move out from under it.
+		if (contains_address(value))
+			return insert(pos, T(value));
+
 		if (pos == last_)
 		{
 			push_back(value);
@@ -385,12 +453,13 @@ public:
 		}
 
 		//There is enough space; shift elements down one and move.
-		auto part = vector_tools::safemove_partition_right(pos_it, last_, get_alloc(), end_);
+		auto part = vector_tools::safemove_partition_right(pos_it, last_, get_alloc(), last_ + 1);
+		++last_;
 		*part.first = value;
-		return pos;
+		return pos_it;
 	}
 
-	iterator insert(const_iterator pos, T &&value)
+	VECTOR_TOOLS_CONSTEXPR iterator insert(const_iterator pos, T &&value)
 	{
 		if (pos == last_)
 		{
@@ -424,13 +493,23 @@ public:
 		}
 
 		//There is enough space; shift elements down one and move.
-		auto part = vector_tools::safemove_partition_right(pos_it, last_, get_alloc(), end_);
+		auto part = vector_tools::safemove_partition_right(pos_it, last_, get_alloc(), last_ + 1);
+		++last_;
 		*part.first = std::move(value);
-		return pos;
+		return pos_it;
 	}
 
-	iterator insert(const_iterator pos, size_type count, const T& value)
+	VECTOR_TOOLS_CONSTEXPR iterator insert(const_iterator pos, size_type count, const T& value)
 	{
+		if (count == 0)
+			return const_cast<iterator>(pos);
+
+		if (contains_address(value))
+		{
+			T copy(value);
+			return insert(pos, count, copy);
+		}
+
 		iterator pos_it = const_cast<iterator>(pos);
 		iterator new_pos{};
 
@@ -446,6 +525,7 @@ public:
 			realloc.new_last = vector_tools::emplace_construct_count(realloc.new_last, count, get_alloc(), value);
 			realloc.new_last = vector_tools::safemove_insert_range(
 				realloc.new_last, get_alloc(), pos_it, last_);
+			replace_storage(realloc);
 		}
 		else
 		{
@@ -463,14 +543,18 @@ public:
 			//Insert to the insertable range.
 			vector_tools::emplace_construct_count(
 				pos_it, size_type(part.end - pos_it), get_alloc(), value);
+			last_ += count;
 		}
 
 		return new_pos; //Launder this?
 	}
 
-	iterator insert(const_iterator pos, std::initializer_list<T> ilist)
+	VECTOR_TOOLS_CONSTEXPR iterator insert(const_iterator pos, std::initializer_list<T> ilist)
 	{
 		iterator pos_it = const_cast<iterator>(pos);
+		if (ilist.size() == 0)
+			return pos_it;
+
 		iterator new_pos{};
 
 		if (size_type(capacity() - size()) < ilist.size())
@@ -486,6 +570,7 @@ public:
 				realloc.new_last, get_alloc(), ilist.begin(), ilist.end());
 			realloc.new_last = vector_tools::safemove_insert_range(
 				realloc.new_last, get_alloc(), pos_it, last_);
+			replace_storage(realloc);
 		}
 		else
 		{
@@ -504,16 +589,51 @@ public:
 			//Insert to the insertable range.
 			vector_tools::copy_insert_range(
 				pos_it, get_alloc(), input, ilist.end());
+			last_ += ilist.size();
 		}
 
 		return new_pos; //Launder this?
 	}
 
+	///Inserts copies of the elements of `first/last` before `pos`.
+	///If there is enough capacity, the new elements are constructed at the end
+	///and then slid into place, so each existing element moves at most once.
+	template<typename ForwardIt, typename = std::enable_if_t<std::is_base_of<std::forward_iterator_tag,
+		typename std::iterator_traits<ForwardIt>::iterator_category>::value>>
+	VECTOR_TOOLS_CONSTEXPR iterator insert(const_iterator pos, ForwardIt first, ForwardIt last)
+	{
+		iterator pos_it = const_cast<iterator>(pos);
+		auto count = size_type(std::distance(first, last));
+
+		if (size_type(capacity() - size()) < count)
+		{
+			//Allocate storage, safe-moving `first_` up to `pos`.
+			//copy-insert `first/last`.
+			//safe-move `pos` to `last_`.
+			//Swap the new storage and delete the old.
+			auto new_cap = calc_expanded_capacity(count);
+			auto realloc = alloc_and_partial_copy(new_cap, pos_it);
+			auto new_pos = realloc.new_last;
+			realloc.new_last = vector_tools::copy_insert_range(
+				realloc.new_last, get_alloc(), first, last);
+			realloc.new_last = vector_tools::safemove_insert_range(
+				realloc.new_last, get_alloc(), pos_it, last_);
+
+			replace_storage(realloc);
+			return new_pos;
+		}
+
+		//Copy-insert at the end, then slide the new elements down to `pos`.
+		auto old_last = last_;
+		last_ = vector_tools::copy_insert_range(last_, get_alloc(), first, last);
+		return vector_tools::slide(old_last, last_, pos_it);
+	}
+
 private:
 	//Given a number of additional elements to add to the `vector`, calculate the new capacity
 	//expanded capacity required.
 	//Takes into account the possibility of a zero capacity.
-	size_type calc_expanded_capacity(size_type num_additional_elements = 1) const
+	VECTOR_TOOLS_CONSTEXPR size_type calc_expanded_capacity(size_type num_additional_elements = 1) const
 	{
 		auto cap = std::max<size_type>(capacity(), 4);
 		if (num_additional_elements > (cap / 2))
@@ -522,6 +642,39 @@ private:
 		return cap + (cap / 2);
 	}
 
+	//True if `value` is one of the elements of this vector.
+	VECTOR_TOOLS_CONSTEXPR bool contains_address(const T &value) const noexcept
+	{
+		auto ptr = std::addressof(value);
+
+		//Ordering unrelated pointers is not a constant expression, but comparing them for equality is.
+		if (vector_tools::detail::is_constant_evaluated())
+		{
+			for (const T *curr = first_; curr != last_; ++curr)
+			{
+				if (curr == ptr)
+					return true;
+			}
+			return false;
+		}
+
+		return !std::less<const T*>{}(ptr, first_) && std::less<const T*>{}(ptr, last_);
+	}
+
+	//Tells an allocator that asks for it how full the storage is, and how big it will grow to next,
+	//so that it can prepare the next buffer ahead of time.
+	VECTOR_TOOLS_CONSTEXPR void hint_growth()
+	{
+		hint_growth(vector_tools::detail::has_growth_hint<Alloc>{});
+	}
+
+	VECTOR_TOOLS_CONSTEXPR void hint_growth(std::false_type) {}
+
+	VECTOR_TOOLS_CONSTEXPR void hint_growth(std::true_type)
+	{
+		get_alloc().growth_hint(size(), capacity(), calc_expanded_capacity());
+	}
+
 	struct realloc_data
 	{
 		T *new_first; T *new_last; T *new_end;
@@ -536,7 +689,7 @@ private:
 	//Allocates `new_cap` of storage, and does a safe-move
 	//of elements from `first_` to `pos`.
 	//Does not destroy anything, and the old member pointers remain.
-	realloc_data alloc_and_partial_copy(size_type new_cap, iterator pos)
+	VECTOR_TOOLS_CONSTEXPR realloc_data alloc_and_partial_copy(size_type new_cap, iterator pos)
 	{
 		auto new_first = std::allocator_traits<Alloc>::allocate(get_alloc(), new_cap);
 		auto new_last = vector_tools::safemove_insert_range(
@@ -546,11 +699,12 @@ private:
 	}
 
 	//Destroys all of the current elements and replaces them with those in `storage`.
-	void replace_storage(realloc_data storage)
+	VECTOR_TOOLS_CONSTEXPR void replace_storage(realloc_data storage)
 	{
 		auto old_cap = capacity();
 		vector_tools::destroy_range(first_, last_, get_alloc());
-		std::allocator_traits<Alloc>::deallocate(get_alloc(), first_, old_cap);
+		if (first_)
+			std::allocator_traits<Alloc>::deallocate(get_alloc(), first_, old_cap);
 
 		first_ = storage.new_first;
 		last_ = storage.new_last;
@@ -562,7 +716,7 @@ private:
 	//destroys the current elements,
 	//deallocates the current memory.
 	//swaps out the member pointers to new elements and memory.
-	void reallocate_storage(size_type new_cap)
+	VECTOR_TOOLS_CONSTEXPR void reallocate_storage(size_type new_cap)
 	{
 		auto old_cap = capacity();
 
@@ -574,7 +728,7 @@ private:
 	//After calling this function, the capacity shall be no larger than `new_cap`.
 	//Performs reallocation if there isn't enough space to hold that many elements.
 	//Allocates *exactly* that many elements.
-	void ensure_space_exact(size_type new_cap)
+	VECTOR_TOOLS_CONSTEXPR void ensure_space_exact(size_type new_cap)
 	{
 		auto curr_cap = capacity();
 		if (new_cap > curr_cap)
@@ -585,22 +739,23 @@ private:
 	}
 
 	//Destroys `count` elements, starting at the end.
-	void remove_from_end(size_type count)
+	VECTOR_TOOLS_CONSTEXPR void remove_from_end(size_type count)
 	{
 		auto new_last = last_ - count;
 		vector_tools::destroy_range(new_last, last_, get_alloc());
 		last_ = new_last;
 	}
 
-	void clear_and_destroy()
+	VECTOR_TOOLS_CONSTEXPR void clear_and_destroy()
 	{
 		clear();
-		std::allocator_traits<Alloc>::deallocate(get_alloc(), first_, size());
+		if (first_)
+			std::allocator_traits<Alloc>::deallocate(get_alloc(), first_, capacity());
 		nullify();
 	}
 
 	//Sets all pointers to nullptr.
-	void nullify()
+	VECTOR_TOOLS_CONSTEXPR void nullify()
 	{
 		first_ = nullptr;
 		last_ = nullptr;
@@ -608,5 +763,23 @@ private:
 	}
 };
 
+#if VECTOR_TOOLS_HAS_CONSTEXPR_ALLOC
+///Calls `build`, which must return a `my_vector` of exactly `N` elements,
+///and copies them into a `std::array`.
+///A vector's storage cannot outlive constant evaluation, but the array can:
+///`constexpr auto table = spill_to_array<256>([] { my_vector<T> vec; ...; return vec; });`
+template<std::size_t N, typename Func>
+constexpr auto spill_to_array(Func build)
+{
+	auto vec = build();
+	if (vec.size() != N)
+		throw std::length_error("spill_to_array: vector size does not match N");
+
+	std::array<typename decltype(vec)::value_type, N> table{};
+	for (std::size_t ix = 0; ix < N; ++ix)
+		table[ix] = std::move(vec[ix]);
+	return table;
+}
+#endif
 
 #endif //MY_VECTOR_TEST_IMPLEMENTATION_HEADER
@@ -0,0 +1,242 @@
+#ifndef POLY_COLLECTION_HEADER
+#define POLY_COLLECTION_HEADER
+
+#include "my_vector.hpp"
+#include <cstddef>
+#include <initializer_list>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <typeindex>
+#include <typeinfo>
+#include <utility>
+
+///A collection of objects derived from `Base`, stored by value.
+///Objects of each concrete type are kept contiguously in their own `my_vector` segment.
+///Iteration goes segment by segment, so virtual calls made on consecutive elements
+///all resolve to the same function, and iteration over known types needs no virtual dispatch at all.
+///The order of elements is only preserved within a segment.
+template<typename Base>
+class poly_collection
+{
+public:
+	using size_type = std::size_t;
+
+	poly_collection() = default;
+	poly_collection(poly_collection &&) = default;
+	poly_collection &operator=(poly_collection &&) = default;
+
+	size_type size() const noexcept
+	{
+		size_type count = 0;
+		for (const auto &seg : segments_)
+			count += seg->size();
+		return count;
+	}
+
+	bool empty() const noexcept { return size() == 0; }
+
+	///The number of distinct concrete types that have been registered.
+	size_type segment_count() const noexcept { return segments_.size(); }
+
+	///Destroys all elements, keeping the segments and their storage.
+	void clear() noexcept
+	{
+		for (auto &seg : segments_)
+			seg->clear();
+	}
+
+	///Creates the segment for `Derived`, so that objects of that type can be
+	///inserted through a reference to `Base`.
+	template<typename Derived>
+	void register_type()
+	{
+		get_segment<Derived>();
+	}
+
+	template<typename Derived>
+	void reserve(size_type new_cap)
+	{
+		get_segment<Derived>().reserve(new_cap);
+	}
+
+	///Returns the elements whose concrete type is `Derived`.
+	template<typename Derived>
+	my_vector<Derived> &segment()
+	{
+		return get_segment<Derived>();
+	}
+
+	template<typename Derived>
+	size_type size() const noexcept
+	{
+		auto seg = find_segment(typeid(Derived));
+		return seg ? seg->size() : 0;
+	}
+
+	template<typename Derived, typename ...Args>
+	Derived &emplace(Args &&...args)
+	{
+		return get_segment<Derived>().emplace_back(std::forward<Args>(args)...);
+	}
+
+	///Inserts a copy of `value` into the segment of its dynamic type.
+	///If the dynamic type is the static type, the segment is created as needed.
+	///Otherwise, the dynamic type must have been registered, or `std::invalid_argument` is thrown.
+	template<typename U>
+	Base &insert(U &&value)
+	{
+		using value_type = std::decay_t<U>;
+		static_assert(std::is_base_of<Base, value_type>::value, "Only types derived from Base can be inserted.");
+
+		return insert_impl(std::forward<U>(value), std::integral_constant<bool, !std::is_abstract<value_type>::value>{});
+	}
+
+	///Calls `func` for every element, one segment at a time.
+	///Elements whose concrete type is one of `Known` are passed as that type,
+	///so calls through them are resolved statically. All others are passed as `Base&`.
+	template<typename ...Known, typename Func>
+	void for_each(Func &&func)
+	{
+		for (auto &seg : segments_)
+		{
+			bool visited = false;
+			(void)std::initializer_list<int>{ (visited = visited || visit_known<Known>(*seg, func), 0)... };
+			if (!visited)
+				visit_erased(*seg, func);
+		}
+	}
+
+private:
+	//The layout of one segment's elements, as seen through `Base`.
+	struct segment_view
+	{
+		unsigned char *first;
+		size_type count;
+		size_type stride;
+		std::ptrdiff_t base_offset;
+	};
+
+	struct segment_base
+	{
+		explicit segment_base(const std::type_info &type) : type(type) {}
+		virtual ~segment_base() = default;
+
+		virtual size_type size() const noexcept = 0;
+		virtual void clear() noexcept = 0;
+		virtual segment_view view() noexcept = 0;
+		virtual Base &push_copy(const Base &value) = 0;
+		virtual Base &push_move(Base &&value) = 0;
+
+		std::type_index type;
+	};
+
+	template<typename Derived>
+	struct typed_segment final : segment_base
+	{
+		typed_segment() : segment_base(typeid(Derived)) {}
+
+		size_type size() const noexcept override { return elements.size(); }
+		void clear() noexcept override { elements.clear(); }
+
+		segment_view view() noexcept override
+		{
+			auto first = elements.data();
+			std::ptrdiff_t offset = 0;
+			if (first)
+			{
+				offset = reinterpret_cast<unsigned char*>(static_cast<Base*>(first)) -
+					reinterpret_cast<unsigned char*>(first);
+			}
+
+			return { reinterpret_cast<unsigned char*>(first), elements.size(), sizeof(Derived), offset };
+		}
+
+		Base &push_copy(const Base &value) override
+		{
+			return elements.emplace_back(static_cast<const Derived&>(value));
+		}
+
+		Base &push_move(Base &&value) override
+		{
+			return elements.emplace_back(static_cast<Derived&&>(value));
+		}
+
+		my_vector<Derived> elements;
+	};
+
+	my_vector<std::unique_ptr<segment_base>> segments_;
+
+	segment_base *find_segment(const std::type_info &type) const noexcept
+	{
+		std::type_index index(type);
+		for (const auto &seg : segments_)
+		{
+			if (seg->type == index)
+				return seg.get();
+		}
+		return nullptr;
+	}
+
+	template<typename Derived>
+	my_vector<Derived> &get_segment()
+	{
+		static_assert(std::is_base_of<Base, Derived>::value, "Segments hold types derived from Base.");
+		static_assert(!std::is_const<Derived>::value && !std::is_reference<Derived>::value,
+			"Segments hold non-const object types.");
+
+		if (auto seg = find_segment(typeid(Derived)))
+			return static_cast<typed_segment<Derived>*>(seg)->elements;
+
+		segments_.push_back(std::make_unique<typed_segment<Derived>>());
+		return static_cast<typed_segment<Derived>&>(*segments_.back()).elements;
+	}
+
+	//The static type can be stored, so only look up the dynamic type if they differ.
+	template<typename U>
+	Base &insert_impl(U &&value, std::true_type)
+	{
+		using value_type = std::decay_t<U>;
+		if (typeid(value) == typeid(value_type))
+			return get_segment<value_type>().emplace_back(std::forward<U>(value));
+
+		return insert_impl(std::forward<U>(value), std::false_type{});
+	}
+
+	template<typename U>
+	Base &insert_impl(U &&value, std::false_type)
+	{
+		auto seg = find_segment(typeid(value));
+		if (!seg)
+			throw std::invalid_argument("poly_collection: dynamic type was not registered");
+
+		return insert_erased(*seg, std::forward<U>(value));
+	}
+
+	static Base &insert_erased(segment_base &seg, const Base &value) { return seg.push_copy(value); }
+	static Base &insert_erased(segment_base &seg, Base &value) { return seg.push_copy(value); }
+	static Base &insert_erased(segment_base &seg, Base &&value) { return seg.push_move(std::move(value)); }
+
+	//One virtual call for the segment; the loop itself is not type-erased.
+	template<typename Func>
+	static void visit_erased(segment_base &seg, Func &func)
+	{
+		auto view = seg.view();
+		auto curr = view.first + view.base_offset;
+		for (size_type ix = 0; ix < view.count; ++ix, curr += view.stride)
+			func(*reinterpret_cast<Base*>(curr));
+	}
+
+	template<typename Derived, typename Func>
+	static bool visit_known(segment_base &seg, Func &func)
+	{
+		if (seg.type != std::type_index(typeid(Derived)))
+			return false;
+
+		for (auto &elem : static_cast<typed_segment<Derived>&>(seg).elements)
+			func(elem);
+		return true;
+	}
+};
+
+#endif //POLY_COLLECTION_HEADER
@@ -0,0 +1,1099 @@
+#ifndef ROARING_BITMAP_HEADER
+#define ROARING_BITMAP_HEADER
+
+#include "my_vector.hpp"
+#include "bit_ops.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+namespace detail
+{
+	///The set of low 16 bits of the ids in one bucket of a `roaring_bitmap`, stored one of three ways:
+	///a sorted array of values, a bitmap of all 65536, or sorted runs of consecutive values.
+	///Arrays hold at most `array_limit` values, and bitmaps more; runs are used whenever they are smallest.
+	struct roaring_container
+	{
+		static constexpr std::uint32_t array_limit = 4096;
+		static constexpr std::size_t word_count = 1024;
+
+		enum class kind_type : unsigned char { array, bitmap, runs };
+
+		kind_type kind = kind_type::array;
+		std::uint32_t cardinality = 0;
+		//The values of an array, or the first and last value of each run, inclusive.
+		my_vector<std::uint16_t> values;
+		//The words of a bitmap.
+		my_vector<std::uint64_t> words;
+
+		std::size_t run_count() const noexcept { return values.size() / 2; }
+		std::uint16_t run_first(std::size_t run) const noexcept { return values[run * 2]; }
+		std::uint16_t run_last(std::size_t run) const noexcept { return values[run * 2 + 1]; }
+
+		std::size_t size_bytes() const noexcept
+		{
+			return values.capacity() * sizeof(std::uint16_t) + words.capacity() * sizeof(std::uint64_t);
+		}
+
+		bool contains(std::uint16_t low) const noexcept
+		{
+			switch (kind)
+			{
+			case kind_type::array:
+				return std::binary_search(values.begin(), values.end(), low);
+			case kind_type::bitmap:
+				return (words[low / 64] >> (low % 64)) & 1;
+			default:
+			{
+				auto run = find_run(low);
+				return run != 0 && low <= run_last(run - 1);
+			}
+			}
+		}
+
+		///Adds `low`. Returns false if it was already present.
+		bool add(std::uint16_t low)
+		{
+			switch (kind)
+			{
+			case kind_type::array:
+			{
+				auto pos = std::lower_bound(values.begin(), values.end(), low);
+				if (pos != values.end() && *pos == low)
+					return false;
+
+				if (cardinality == array_limit)
+				{
+					set_bitmap(to_words());
+					words[low / 64] |= std::uint64_t(1) << (low % 64);
+					++cardinality;
+					return true;
+				}
+
+				insert_values(size_t(pos - values.begin()), &low, 1);
+				++cardinality;
+				return true;
+			}
+			case kind_type::bitmap:
+			{
+				auto &word = words[low / 64];
+				auto bit = std::uint64_t(1) << (low % 64);
+				if (word & bit)
+					return false;
+				word |= bit;
+				++cardinality;
+				return true;
+			}
+			default:
+				if (!add_to_runs(low))
+					return false;
+				++cardinality;
+				leave_runs_if_larger();
+				return true;
+			}
+		}
+
+		///Removes `low`. Returns false if it was not present.
+		bool remove(std::uint16_t low)
+		{
+			switch (kind)
+			{
+			case kind_type::array:
+			{
+				auto pos = std::lower_bound(values.begin(), values.end(), low);
+				if (pos == values.end() || *pos != low)
+					return false;
+				values.erase(pos);
+				--cardinality;
+				return true;
+			}
+			case kind_type::bitmap:
+			{
+				auto &word = words[low / 64];
+				auto bit = std::uint64_t(1) << (low % 64);
+				if (!(word & bit))
+					return false;
+				word &= ~bit;
+				if (--cardinality == array_limit)
+					set_array(words_to_array(words));
+				return true;
+			}
+			default:
+				if (!remove_from_runs(low))
+					return false;
+				--cardinality;
+				leave_runs_if_larger();
+				return true;
+			}
+		}
+
+		template<typename Func>
+		void for_each(std::uint32_t high, Func &&func) const
+		{
+			switch (kind)
+			{
+			case kind_type::array:
+				for (auto low : values)
+					func(high | low);
+				break;
+			case kind_type::bitmap:
+				for (std::size_t ix = 0; ix != word_count; ++ix)
+				{
+					vector_tools::for_each_set_bit(words[ix], ix * 64, [&](std::size_t low) {
+						func(high | std::uint32_t(low));
+					});
+				}
+				break;
+			default:
+				for (std::size_t run = 0; run != run_count(); ++run)
+				{
+					for (std::uint32_t low = run_first(run); low <= run_last(run); ++low)
+						func(high | low);
+				}
+				break;
+			}
+		}
+
+		///The contents as a bitmap, whatever the representation.
+		my_vector<std::uint64_t> to_words() const
+		{
+			if (kind == kind_type::bitmap)
+				return my_vector<std::uint64_t>(words.begin(), words.end());
+
+			my_vector<std::uint64_t> out(word_count);
+			if (kind == kind_type::array)
+			{
+				for (auto low : values)
+					out[low / 64] |= std::uint64_t(1) << (low % 64);
+			}
+			else
+			{
+				for (std::size_t run = 0; run != run_count(); ++run)
+					set_word_range(out.data(), run_first(run), run_last(run));
+			}
+			return out;
+		}
+
+		///Takes a bitmap, choosing the smallest representation for it.
+		void assign_words(my_vector<std::uint64_t> &&bits)
+		{
+			std::size_t count = 0;
+			std::size_t runs = 0;
+			std::uint64_t carry = 0;
+			for (auto word : bits)
+			{
+				count += vector_tools::popcount(word);
+				runs += vector_tools::popcount(word & ~((word << 1) | carry));
+				carry = word >> 63;
+			}
+
+			cardinality = std::uint32_t(count);
+			if (runs_bytes(runs) < non_run_bytes(cardinality))
+				set_runs(words_to_runs(bits, runs));
+			else if (cardinality <= array_limit)
+				set_array(words_to_array(bits));
+			else
+				set_bitmap(std::move(bits));
+		}
+
+		///Takes sorted, unique values, choosing the smallest representation for them.
+		void assign_array(my_vector<std::uint16_t> &&sorted)
+		{
+			cardinality = std::uint32_t(sorted.size());
+			std::size_t runs = sorted.empty() ? 0 : 1;
+			for (std::size_t ix = 1; ix < sorted.size(); ++ix)
+				runs += sorted[ix] != sorted[ix - 1] + 1;
+
+			if (runs_bytes(runs) < non_run_bytes(cardinality))
+			{
+				my_vector<std::uint16_t> out;
+				out.reserve(runs * 2);
+				for (std::size_t ix = 0; ix != sorted.size(); ++ix)
+				{
+					if (ix == 0 || sorted[ix] != sorted[ix - 1] + 1)
+					{
+						if (ix != 0)
+							out.push_back(sorted[ix - 1]);
+						out.push_back(sorted[ix]);
+					}
+				}
+				out.push_back(sorted.back());
+				set_runs(std::move(out));
+			}
+			else if (cardinality <= array_limit)
+			{
+				set_array(std::move(sorted));
+			}
+			else
+			{
+				my_vector<std::uint64_t> bits(word_count);
+				for (auto low : sorted)
+					bits[low / 64] |= std::uint64_t(1) << (low % 64);
+				set_bitmap(std::move(bits));
+			}
+		}
+
+		void set_array(my_vector<std::uint16_t> &&sorted) noexcept
+		{
+			kind = kind_type::array;
+			values.swap(sorted);
+			words = my_vector<std::uint64_t>();
+		}
+
+		void set_bitmap(my_vector<std::uint64_t> &&bits) noexcept
+		{
+			kind = kind_type::bitmap;
+			words.swap(bits);
+			values = my_vector<std::uint16_t>();
+		}
+
+		void set_runs(my_vector<std::uint16_t> &&runs) noexcept
+		{
+			kind = kind_type::runs;
+			values.swap(runs);
+			words = my_vector<std::uint64_t>();
+		}
+
+		//The bytes each representation takes when serialized, which also decides the one kept in memory.
+		static std::size_t runs_bytes(std::size_t runs) noexcept { return 2 + 4 * runs; }
+
+		static std::size_t non_run_bytes(std::size_t count) noexcept
+		{
+			return count <= array_limit ? 2 * count : word_count * sizeof(std::uint64_t);
+		}
+
+		static void set_word_range(std::uint64_t *bits, std::uint32_t first, std::uint32_t last) noexcept
+		{
+			auto first_word = first / 64;
+			auto last_word = last / 64;
+			auto first_mask = ~std::uint64_t(0) << (first % 64);
+			auto last_mask = ~std::uint64_t(0) >> (63 - last % 64);
+			if (first_word == last_word)
+			{
+				bits[first_word] |= first_mask & last_mask;
+				return;
+			}
+
+			bits[first_word] |= first_mask;
+			for (auto ix = first_word + 1; ix < last_word; ++ix)
+				bits[ix] = ~std::uint64_t(0);
+			bits[last_word] |= last_mask;
+		}
+
+		static my_vector<std::uint16_t> words_to_array(const my_vector<std::uint64_t> &bits)
+		{
+			my_vector<std::uint16_t> out;
+			std::size_t count = 0;
+			for (auto word : bits)
+				count += vector_tools::popcount(word);
+
+			out.reserve(count);
+			for (std::size_t ix = 0; ix != bits.size(); ++ix)
+			{
+				vector_tools::for_each_set_bit(bits[ix], ix * 64, [&out](std::size_t low) {
+					out.push_back(std::uint16_t(low));
+				});
+			}
+			return out;
+		}
+
+		static my_vector<std::uint16_t> words_to_runs(const my_vector<std::uint64_t> &bits, std::size_t runs)
+		{
+			my_vector<std::uint16_t> out;
+			out.reserve(runs * 2);
+			bool in_run = false;
+			for (std::uint32_t low = 0; low != word_count * 64; ++low)
+			{
+				bool set = (bits[low / 64] >> (low % 64)) & 1;
+				if (set != in_run)
+				{
+					out.push_back(std::uint16_t(set ? low : low - 1));
+					in_run = set;
+				}
+			}
+			if (in_run)
+				out.push_back(std::uint16_t(0xFFFF));
+			return out;
+		}
+
+	private:
+		//One past the index of the last run starting at or before `low`; 0 if there is none.
+		std::size_t find_run(std::uint16_t low) const noexcept
+		{
+			std::size_t lo = 0;
+			std::size_t hi = run_count();
+			while (lo != hi)
+			{
+				auto mid = lo + (hi - lo) / 2;
+				if (run_first(mid) <= low)
+					lo = mid + 1;
+				else
+					hi = mid;
+			}
+			return lo;
+		}
+
+		void insert_values(std::size_t pos, const std::uint16_t *input, std::size_t count)
+		{
+			values.insert(values.begin() + pos, input, input + count);
+		}
+
+		bool add_to_runs(std::uint16_t low)
+		{
+			auto next = find_run(low);
+			if (next != 0 && low <= run_last(next - 1))
+				return false;
+
+			bool joins_prev = next != 0 && std::uint32_t(run_last(next - 1)) + 1 == low;
+			bool joins_next = next != run_count() && std::uint32_t(low) + 1 == run_first(next);
+			if (joins_prev && joins_next)
+			{
+				values[(next - 1) * 2 + 1] = run_last(next);
+				values.erase(values.begin() + next * 2, values.begin() + next * 2 + 2);
+			}
+			else if (joins_prev)
+			{
+				values[(next - 1) * 2 + 1] = low;
+			}
+			else if (joins_next)
+			{
+				values[next * 2] = low;
+			}
+			else
+			{
+				std::uint16_t run[] = { low, low };
+				insert_values(next * 2, run, 2);
+			}
+			return true;
+		}
+
+		bool remove_from_runs(std::uint16_t low)
+		{
+			auto next = find_run(low);
+			if (next == 0 || run_last(next - 1) < low)
+				return false;
+
+			auto run = next - 1;
+			auto first = run_first(run);
+			auto last = run_last(run);
+			if (first == last)
+			{
+				values.erase(values.begin() + run * 2, values.begin() + run * 2 + 2);
+			}
+			else if (low == first)
+			{
+				values[run * 2] = std::uint16_t(low + 1);
+			}
+			else if (low == last)
+			{
+				values[run * 2 + 1] = std::uint16_t(low - 1);
+			}
+			else
+			{
+				std::uint16_t split[] = { std::uint16_t(low + 1), last };
+				insert_values(next * 2, split, 2);
+				values[run * 2 + 1] = std::uint16_t(low - 1);
+			}
+			return true;
+		}
+
+		void leave_runs_if_larger()
+		{
+			if (runs_bytes(run_count()) <= non_run_bytes(cardinality))
+				return;
+
+			if (cardinality <= array_limit)
+			{
+				my_vector<std::uint16_t> out;
+				out.reserve(cardinality);
+				for_each(0, [&out](std::uint32_t low) { out.push_back(std::uint16_t(low)); });
+				set_array(std::move(out));
+			}
+			else
+			{
+				set_bitmap(to_words());
+			}
+		}
+	};
+
+	//Set operations on the containers of one bucket.
+	//Arrays are merged or probed value by value; anything else is done a word at a time over bitmaps,
+	//in plain loops the compiler can vectorize. Results are stored in their smallest representation.
+
+	inline roaring_container roaring_and(const roaring_container &lhs, const roaring_container &rhs)
+	{
+		using kind_type = roaring_container::kind_type;
+		roaring_container out;
+		if (lhs.kind == kind_type::array && rhs.kind == kind_type::array)
+		{
+			my_vector<std::uint16_t> values;
+			values.reserve(std::min(lhs.values.size(), rhs.values.size()));
+			std::set_intersection(lhs.values.begin(), lhs.values.end(),
+				rhs.values.begin(), rhs.values.end(), std::back_inserter(values));
+			out.assign_array(std::move(values));
+		}
+		else if (lhs.kind == kind_type::array || rhs.kind == kind_type::array)
+		{
+			auto &small = lhs.kind == kind_type::array ? lhs : rhs;
+			auto &large = lhs.kind == kind_type::array ? rhs : lhs;
+			my_vector<std::uint16_t> values;
+			values.reserve(small.values.size());
+			for (auto low : small.values)
+			{
+				if (large.contains(low))
+					values.push_back(low);
+			}
+			out.assign_array(std::move(values));
+		}
+		else
+		{
+			auto bits = lhs.to_words();
+			auto other = rhs.to_words();
+			for (std::size_t ix = 0; ix != roaring_container::word_count; ++ix)
+				bits[ix] &= other[ix];
+			out.assign_words(std::move(bits));
+		}
+		return out;
+	}
+
+	inline roaring_container roaring_or(const roaring_container &lhs, const roaring_container &rhs)
+	{
+		using kind_type = roaring_container::kind_type;
+		roaring_container out;
+		if (lhs.kind == kind_type::array && rhs.kind == kind_type::array)
+		{
+			my_vector<std::uint16_t> values;
+			values.reserve(lhs.values.size() + rhs.values.size());
+			std::set_union(lhs.values.begin(), lhs.values.end(),
+				rhs.values.begin(), rhs.values.end(), std::back_inserter(values));
+			out.assign_array(std::move(values));
+		}
+		else
+		{
+			auto bits = lhs.to_words();
+			if (rhs.kind == kind_type::array)
+			{
+				for (auto low : rhs.values)
+					bits[low / 64] |= std::uint64_t(1) << (low % 64);
+			}
+			else
+			{
+				auto other = rhs.to_words();
+				for (std::size_t ix = 0; ix != roaring_container::word_count; ++ix)
+					bits[ix] |= other[ix];
+			}
+			out.assign_words(std::move(bits));
+		}
+		return out;
+	}
+
+	inline roaring_container roaring_andnot(const roaring_container &lhs, const roaring_container &rhs)
+	{
+		using kind_type = roaring_container::kind_type;
+		roaring_container out;
+		if (lhs.kind == kind_type::array)
+		{
+			my_vector<std::uint16_t> values;
+			values.reserve(lhs.values.size());
+			for (auto low : lhs.values)
+			{
+				if (!rhs.contains(low))
+					values.push_back(low);
+			}
+			out.assign_array(std::move(values));
+		}
+		else
+		{
+			auto bits = lhs.to_words();
+			if (rhs.kind == kind_type::array)
+			{
+				for (auto low : rhs.values)
+					bits[low / 64] &= ~(std::uint64_t(1) << (low % 64));
+			}
+			else
+			{
+				auto other = rhs.to_words();
+				for (std::size_t ix = 0; ix != roaring_container::word_count; ++ix)
+					bits[ix] &= ~other[ix];
+			}
+			out.assign_words(std::move(bits));
+		}
+		return out;
+	}
+
+	inline std::size_t roaring_and_cardinality(const roaring_container &lhs, const roaring_container &rhs)
+	{
+		using kind_type = roaring_container::kind_type;
+		if (lhs.kind == kind_type::array || rhs.kind == kind_type::array)
+		{
+			auto &small = lhs.kind == kind_type::array ? lhs : rhs;
+			auto &large = lhs.kind == kind_type::array ? rhs : lhs;
+			std::size_t count = 0;
+			for (auto low : small.values)
+				count += large.contains(low);
+			return count;
+		}
+
+		if (lhs.kind == kind_type::bitmap && rhs.kind == kind_type::bitmap)
+		{
+			std::size_t count = 0;
+			for (std::size_t ix = 0; ix != roaring_container::word_count; ++ix)
+				count += vector_tools::popcount(lhs.words[ix] & rhs.words[ix]);
+			return count;
+		}
+
+		auto bits = lhs.to_words();
+		auto other = rhs.to_words();
+		std::size_t count = 0;
+		for (std::size_t ix = 0; ix != roaring_container::word_count; ++ix)
+			count += vector_tools::popcount(bits[ix] & other[ix]);
+		return count;
+	}
+
+	inline bool roaring_equal(const roaring_container &lhs, const roaring_container &rhs)
+	{
+		if (lhs.cardinality != rhs.cardinality)
+			return false;
+		if (lhs.kind == rhs.kind)
+		{
+			return std::equal(lhs.values.begin(), lhs.values.end(), rhs.values.begin(), rhs.values.end()) &&
+				std::equal(lhs.words.begin(), lhs.words.end(), rhs.words.begin(), rhs.words.end());
+		}
+
+		auto bits = lhs.to_words();
+		auto other = rhs.to_words();
+		return std::equal(bits.begin(), bits.end(), other.begin());
+	}
+}
+
+///A compressed set of 32-bit ids, after Roaring bitmaps.
+///Ids are bucketed by their high 16 bits; each non-empty bucket holds its ids' low 16 bits in whichever
+///container is smallest: a sorted array for sparse buckets, a 65536-bit bitmap for dense ones, or runs of
+///consecutive values. Containers convert between representations as they fill and empty.
+///Set operations work bucket by bucket, so buckets present on only one side cost nothing to intersect,
+///and dense buckets are combined 64 ids per instruction.
+///`serialize` writes the portable Roaring format, which other Roaring implementations can read.
+class roaring_bitmap
+{
+public:
+	using value_type = std::uint32_t;
+	using size_type = std::size_t;
+
+	roaring_bitmap() = default;
+
+	///Makes a bitmap of the ids in `ids`, which need not be sorted or unique.
+	explicit roaring_bitmap(const my_vector<std::uint32_t> &ids)
+	{
+		if (std::is_sorted(ids.begin(), ids.end()))
+		{
+			assign_sorted(ids.begin(), ids.end());
+			return;
+		}
+
+		my_vector<std::uint32_t> sorted(ids.begin(), ids.end());
+		std::sort(sorted.begin(), sorted.end());
+		assign_sorted(sorted.begin(), sorted.end());
+	}
+
+	///The ids, in ascending order.
+	my_vector<std::uint32_t> to_vector() const
+	{
+		my_vector<std::uint32_t> out;
+		out.reserve(cardinality());
+		for_each([&out](std::uint32_t id) { out.push_back(id); });
+		return out;
+	}
+
+	///The number of ids.
+	size_type cardinality() const noexcept
+	{
+		size_type count = 0;
+		for (auto &curr : containers_)
+			count += curr.cardinality;
+		return count;
+	}
+
+	bool empty() const noexcept { return keys_.empty(); }
+
+	void clear() noexcept
+	{
+		keys_.clear();
+		containers_.clear();
+	}
+
+	///The bytes of storage held, which is roughly what `serialize` would write.
+	size_type size_bytes() const noexcept
+	{
+		size_type bytes = keys_.capacity() * sizeof(std::uint16_t) + containers_.capacity() * sizeof(container);
+		for (auto &curr : containers_)
+			bytes += curr.size_bytes();
+		return bytes;
+	}
+
+	bool contains(std::uint32_t id) const noexcept
+	{
+		auto pos = find_key(std::uint16_t(id >> 16));
+		return pos != keys_.size() && keys_[pos] == (id >> 16) && containers_[pos].contains(std::uint16_t(id));
+	}
+
+	///Adds `id`. Returns false if it was already present.
+	bool add(std::uint32_t id)
+	{
+		auto key = std::uint16_t(id >> 16);
+		auto pos = find_key(key);
+		if (pos == keys_.size() || keys_[pos] != key)
+		{
+			container curr;
+			curr.add(std::uint16_t(id));
+			insert_container(pos, key, std::move(curr));
+			return true;
+		}
+		return containers_[pos].add(std::uint16_t(id));
+	}
+
+	///Removes `id`. Returns false if it was not present.
+	bool remove(std::uint32_t id)
+	{
+		auto key = std::uint16_t(id >> 16);
+		auto pos = find_key(key);
+		if (pos == keys_.size() || keys_[pos] != key || !containers_[pos].remove(std::uint16_t(id)))
+			return false;
+
+		if (containers_[pos].cardinality == 0)
+		{
+			keys_.erase(keys_.begin() + pos);
+			containers_.erase(containers_.begin() + pos);
+		}
+		return true;
+	}
+
+	///Converts every container to its smallest representation, which may turn arrays and bitmaps into runs.
+	///Set operations already produce their results this way; this catches up after `add` and `remove`,
+	///and also gives back the spare capacity that adding buckets one at a time leaves behind.
+	void optimize()
+	{
+		keys_.shrink_to_fit();
+		containers_.shrink_to_fit();
+		for (auto &curr : containers_)
+		{
+			if (curr.kind == container::kind_type::array)
+				curr.assign_array(std::move(curr.values));
+			else if (curr.kind == container::kind_type::bitmap)
+				curr.assign_words(std::move(curr.words));
+		}
+	}
+
+	///Calls `func(id)` for each id, in ascending order.
+	template<typename Func>
+	void for_each(Func &&func) const
+	{
+		for (size_type ix = 0; ix != keys_.size(); ++ix)
+			containers_[ix].for_each(std::uint32_t(keys_[ix]) << 16, func);
+	}
+
+	friend roaring_bitmap operator&(const roaring_bitmap &lhs, const roaring_bitmap &rhs)
+	{
+		roaring_bitmap out;
+		size_type left = 0;
+		size_type right = 0;
+		while (left != lhs.keys_.size() && right != rhs.keys_.size())
+		{
+			if (lhs.keys_[left] < rhs.keys_[right])
+				++left;
+			else if (rhs.keys_[right] < lhs.keys_[left])
+				++right;
+			else
+			{
+				out.push_container(lhs.keys_[left], detail::roaring_and(lhs.containers_[left], rhs.containers_[right]));
+				++left;
+				++right;
+			}
+		}
+		return out;
+	}
+
+	friend roaring_bitmap operator|(const roaring_bitmap &lhs, const roaring_bitmap &rhs)
+	{
+		roaring_bitmap out;
+		out.keys_.reserve(lhs.keys_.size() + rhs.keys_.size());
+		out.containers_.reserve(lhs.keys_.size() + rhs.keys_.size());
+		size_type left = 0;
+		size_type right = 0;
+		while (left != lhs.keys_.size() || right != rhs.keys_.size())
+		{
+			if (right == rhs.keys_.size() || (left != lhs.keys_.size() && lhs.keys_[left] < rhs.keys_[right]))
+			{
+				out.push_container(lhs.keys_[left], lhs.containers_[left]);
+				++left;
+			}
+			else if (left == lhs.keys_.size() || rhs.keys_[right] < lhs.keys_[left])
+			{
+				out.push_container(rhs.keys_[right], rhs.containers_[right]);
+				++right;
+			}
+			else
+			{
+				out.push_container(lhs.keys_[left], detail::roaring_or(lhs.containers_[left], rhs.containers_[right]));
+				++left;
+				++right;
+			}
+		}
+		return out;
+	}
+
+	///The ids in `lhs` but not in `rhs`.
+	friend roaring_bitmap operator-(const roaring_bitmap &lhs, const roaring_bitmap &rhs)
+	{
+		roaring_bitmap out;
+		size_type right = 0;
+		for (size_type left = 0; left != lhs.keys_.size(); ++left)
+		{
+			while (right != rhs.keys_.size() && rhs.keys_[right] < lhs.keys_[left])
+				++right;
+
+			if (right != rhs.keys_.size() && rhs.keys_[right] == lhs.keys_[left])
+				out.push_container(lhs.keys_[left], detail::roaring_andnot(lhs.containers_[left], rhs.containers_[right]));
+			else
+				out.push_container(lhs.keys_[left], lhs.containers_[left]);
+		}
+		return out;
+	}
+
+	roaring_bitmap &operator&=(const roaring_bitmap &rhs) { return *this = *this & rhs; }
+	roaring_bitmap &operator|=(const roaring_bitmap &rhs) { return *this = *this | rhs; }
+	roaring_bitmap &operator-=(const roaring_bitmap &rhs) { return *this = *this - rhs; }
+
+	///The number of ids in both bitmaps, without building their intersection.
+	friend size_type and_cardinality(const roaring_bitmap &lhs, const roaring_bitmap &rhs)
+	{
+		size_type count = 0;
+		size_type left = 0;
+		size_type right = 0;
+		while (left != lhs.keys_.size() && right != rhs.keys_.size())
+		{
+			if (lhs.keys_[left] < rhs.keys_[right])
+				++left;
+			else if (rhs.keys_[right] < lhs.keys_[left])
+				++right;
+			else
+				count += detail::roaring_and_cardinality(lhs.containers_[left++], rhs.containers_[right++]);
+		}
+		return count;
+	}
+
+	friend bool operator==(const roaring_bitmap &lhs, const roaring_bitmap &rhs)
+	{
+		if (lhs.keys_.size() != rhs.keys_.size() ||
+			!std::equal(lhs.keys_.begin(), lhs.keys_.end(), rhs.keys_.begin()))
+		{
+			return false;
+		}
+
+		for (size_type ix = 0; ix != lhs.keys_.size(); ++ix)
+		{
+			if (!detail::roaring_equal(lhs.containers_[ix], rhs.containers_[ix]))
+				return false;
+		}
+		return true;
+	}
+
+	friend bool operator!=(const roaring_bitmap &lhs, const roaring_bitmap &rhs) { return !(lhs == rhs); }
+
+	///Writes the bitmap in the portable Roaring format, little-endian.
+	my_vector<unsigned char> serialize() const
+	{
+		auto count = keys_.size();
+		bool has_runs = std::any_of(containers_.begin(), containers_.end(),
+			[](const container &curr) { return curr.kind == container::kind_type::runs; });
+		bool has_offsets = !has_runs || count >= no_offset_threshold;
+
+		my_vector<unsigned char> out;
+		if (has_runs)
+		{
+			put16(out, serial_cookie);
+			put16(out, std::uint16_t(count - 1));
+			auto bitset = out.size();
+			out.resize(bitset + (count + 7) / 8);
+			for (size_type ix = 0; ix != count; ++ix)
+			{
+				if (containers_[ix].kind == container::kind_type::runs)
+					out[bitset + ix / 8] |= (unsigned char)(1 << (ix % 8));
+			}
+		}
+		else
+		{
+			put32(out, serial_cookie_no_runs);
+			put32(out, std::uint32_t(count));
+		}
+
+		for (size_type ix = 0; ix != count; ++ix)
+		{
+			put16(out, keys_[ix]);
+			put16(out, std::uint16_t(containers_[ix].cardinality - 1));
+		}
+
+		auto offsets = out.size();
+		if (has_offsets)
+			out.resize(offsets + 4 * count);
+
+		for (size_type ix = 0; ix != count; ++ix)
+		{
+			if (has_offsets)
+				poke32(out.data() + offsets + 4 * ix, std::uint32_t(out.size()));
+
+			auto &curr = containers_[ix];
+			switch (curr.kind)
+			{
+			case container::kind_type::array:
+				for (auto low : curr.values)
+					put16(out, low);
+				break;
+			case container::kind_type::bitmap:
+				for (auto word : curr.words)
+				{
+					put32(out, std::uint32_t(word));
+					put32(out, std::uint32_t(word >> 32));
+				}
+				break;
+			default:
+				put16(out, std::uint16_t(curr.run_count()));
+				for (size_type run = 0; run != curr.run_count(); ++run)
+				{
+					put16(out, curr.run_first(run));
+					put16(out, std::uint16_t(curr.run_last(run) - curr.run_first(run)));
+				}
+				break;
+			}
+		}
+		return out;
+	}
+
+	///Reads a bitmap in the portable Roaring format.
+	///Throws `std::invalid_argument` if the data is truncated or not a valid bitmap.
+	static roaring_bitmap deserialize(const unsigned char *data, size_type size)
+	{
+		reader in{ data, data + size };
+		auto cookie = in.get32();
+		size_type count = 0;
+		const unsigned char *run_flags = nullptr;
+		if ((cookie & 0xFFFF) == serial_cookie)
+		{
+			count = (cookie >> 16) + 1;
+			run_flags = in.skip((count + 7) / 8);
+		}
+		else if (cookie == serial_cookie_no_runs)
+		{
+			count = in.get32();
+		}
+		else
+		{
+			malformed();
+		}
+
+		if (count > 0x10000)
+			malformed();
+
+		roaring_bitmap out;
+		out.keys_.reserve(count);
+		out.containers_.reserve(count);
+
+		auto header = in.skip(4 * count);
+		if (!run_flags || count >= no_offset_threshold)
+			in.skip(4 * count);
+
+		for (size_type ix = 0; ix != count; ++ix)
+		{
+			auto key = std::uint16_t(header[4 * ix] | (header[4 * ix + 1] << 8));
+			auto cardinality = std::uint32_t(header[4 * ix + 2] | (header[4 * ix + 3] << 8)) + 1;
+			if (ix != 0 && !(out.keys_.back() < key))
+				malformed();
+
+			container curr;
+			if (run_flags && (run_flags[ix / 8] >> (ix % 8)) & 1)
+				read_runs(in, cardinality, curr);
+			else if (cardinality <= container::array_limit)
+				read_array(in, cardinality, curr);
+			else
+				read_bitmap(in, cardinality, curr);
+
+			out.keys_.push_back(key);
+			out.containers_.push_back(std::move(curr));
+		}
+		return out;
+	}
+
+	static roaring_bitmap deserialize(const my_vector<unsigned char> &bytes)
+	{
+		return deserialize(bytes.data(), bytes.size());
+	}
+
+private:
+	using container = detail::roaring_container;
+
+	static constexpr std::uint16_t serial_cookie = 12347;
+	static constexpr std::uint32_t serial_cookie_no_runs = 12346;
+	//Below this many containers, a format with runs has no offset header.
+	static constexpr size_type no_offset_threshold = 4;
+
+	//The high 16 bits of each bucket's ids, ascending, and the bucket's container.
+	my_vector<std::uint16_t> keys_;
+	my_vector<container> containers_;
+
+	size_type find_key(std::uint16_t key) const noexcept
+	{
+		return size_type(std::lower_bound(keys_.begin(), keys_.end(), key) - keys_.begin());
+	}
+
+	void insert_container(size_type pos, std::uint16_t key, container &&curr)
+	{
+		keys_.insert(keys_.begin() + pos, key);
+		try
+		{
+			containers_.insert(containers_.begin() + pos, std::move(curr));
+		}
+		catch (...)
+		{
+			keys_.erase(keys_.begin() + pos);
+			throw;
+		}
+	}
+
+	//Appends a bucket after all the others, unless it is empty.
+	void push_container(std::uint16_t key, container curr)
+	{
+		if (curr.cardinality == 0)
+			return;
+		keys_.push_back(key);
+		containers_.push_back(std::move(curr));
+	}
+
+	template<typename It>
+	void assign_sorted(It first, It last)
+	{
+		while (first != last)
+		{
+			auto key = std::uint16_t(*first >> 16);
+			my_vector<std::uint16_t> values;
+			for (; first != last && (*first >> 16) == key; ++first)
+			{
+				if (values.empty() || values.back() != std::uint16_t(*first))
+					values.push_back(std::uint16_t(*first));
+			}
+
+			container curr;
+			curr.assign_array(std::move(values));
+			push_container(key, std::move(curr));
+		}
+	}
+
+	static void put16(my_vector<unsigned char> &out, std::uint16_t value)
+	{
+		out.push_back((unsigned char)(value));
+		out.push_back((unsigned char)(value >> 8));
+	}
+
+	static void put32(my_vector<unsigned char> &out, std::uint32_t value)
+	{
+		put16(out, std::uint16_t(value));
+		put16(out, std::uint16_t(value >> 16));
+	}
+
+	static void poke32(unsigned char *out, std::uint32_t value) noexcept
+	{
+		for (int ix = 0; ix != 4; ++ix)
+			out[ix] = (unsigned char)(value >> (8 * ix));
+	}
+
+	[[noreturn]] static void malformed()
+	{
+		throw std::invalid_argument("roaring_bitmap: malformed serialized data");
+	}
+
+	struct reader
+	{
+		const unsigned char *curr;
+		const unsigned char *end;
+
+		const unsigned char *skip(size_type bytes)
+		{
+			if (size_type(end - curr) < bytes)
+				malformed();
+			auto start = curr;
+			curr += bytes;
+			return start;
+		}
+
+		std::uint16_t get16()
+		{
+			auto bytes = skip(2);
+			return std::uint16_t(bytes[0] | (bytes[1] << 8));
+		}
+
+		std::uint32_t get32()
+		{
+			auto low = get16();
+			return low | (std::uint32_t(get16()) << 16);
+		}
+	};
+
+	static void read_array(reader &in, std::uint32_t cardinality, container &out)
+	{
+		my_vector<std::uint16_t> values;
+		values.reserve(cardinality);
+		for (std::uint32_t ix = 0; ix != cardinality; ++ix)
+		{
+			auto low = in.get16();
+			if (ix != 0 && !(values.back() < low))
+				malformed();
+			values.push_back(low);
+		}
+		out.cardinality = cardinality;
+		out.set_array(std::move(values));
+	}
+
+	static void read_bitmap(reader &in, std::uint32_t cardinality, container &out)
+	{
+		my_vector<std::uint64_t> words;
+		words.reserve(container::word_count);
+		size_type count = 0;
+		for (size_type ix = 0; ix != container::word_count; ++ix)
+		{
+			auto low = in.get32();
+			auto word = low | (std::uint64_t(in.get32()) << 32);
+			count += vector_tools::popcount(word);
+			words.push_back(word);
+		}
+		if (count != cardinality)
+			malformed();
+		out.cardinality = cardinality;
+		out.set_bitmap(std::move(words));
+	}
+
+	static void read_runs(reader &in, std::uint32_t cardinality, container &out)
+	{
+		auto runs = in.get16();
+		my_vector<std::uint16_t> values;
+		values.reserve(runs * 2);
+		std::uint32_t count = 0;
+		for (std::uint32_t run = 0; run != runs; ++run)
+		{
+			std::uint32_t first = in.get16();
+			std::uint32_t last = first + in.get16();
+			//Runs must be ascending, apart, and within the bucket.
+			if (last > 0xFFFF || (run != 0 && first <= std::uint32_t(values.back()) + 1))
+				malformed();
+			values.push_back(std::uint16_t(first));
+			values.push_back(std::uint16_t(last));
+			count += last - first + 1;
+		}
+		if (runs == 0 || count != cardinality)
+			malformed();
+		out.cardinality = cardinality;
+		out.set_runs(std::move(values));
+	}
+};
+
+#endif //ROARING_BITMAP_HEADER
@@ -0,0 +1,242 @@
+#ifndef SHARED_BUFFER_HEADER
+#define SHARED_BUFFER_HEADER
+
+#include "my_vector.hpp"
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+
+namespace detail
+{
+	///Reference count for a shared buffer. The atomic version may be shared across threads.
+	template<bool Atomic>
+	struct buffer_refcount
+	{
+		std::atomic<std::size_t> count{ 1 };
+
+		void acquire() noexcept { count.fetch_add(1, std::memory_order_relaxed); }
+
+		//Returns true if this was the last reference.
+		bool release() noexcept { return count.fetch_sub(1, std::memory_order_acq_rel) == 1; }
+
+		std::size_t use_count() const noexcept { return count.load(std::memory_order_acquire); }
+	};
+
+	template<>
+	struct buffer_refcount<false>
+	{
+		std::size_t count = 1;
+
+		void acquire() noexcept { ++count; }
+		bool release() noexcept { return --count == 0; }
+		std::size_t use_count() const noexcept { return count; }
+	};
+
+	template<typename T, bool Atomic>
+	struct buffer_control : buffer_refcount<Atomic>
+	{
+		explicit buffer_control(my_vector<T> &&vec) : values(std::move(vec)) {}
+
+		my_vector<T> values;
+	};
+}
+
+///An immutable view of part of a `shared_buffer`, which keeps the whole buffer alive.
+///Copying a slice only copies a pointer and a length and bumps the reference count.
+///The buffer is freed when the last slice referencing it is destroyed.
+template<typename T, bool Atomic = true>
+class buffer_slice
+{
+public:
+	using value_type = T;
+	using size_type = std::size_t;
+	using const_reference = const T&;
+	using const_iterator = const T*;
+
+	buffer_slice() noexcept : control_(nullptr), first_(nullptr), size_(0) {}
+
+	buffer_slice(const buffer_slice &other) noexcept
+		: control_(other.control_), first_(other.first_), size_(other.size_)
+	{
+		if (control_)
+			control_->acquire();
+	}
+
+	buffer_slice(buffer_slice &&other) noexcept
+		: control_(other.control_), first_(other.first_), size_(other.size_)
+	{
+		other.nullify();
+	}
+
+	~buffer_slice()
+	{
+		release();
+	}
+
+	buffer_slice &operator=(const buffer_slice &other) noexcept
+	{
+		buffer_slice temp(other);
+		swap(temp);
+		return *this;
+	}
+
+	buffer_slice &operator=(buffer_slice &&other) noexcept
+	{
+		if (this == &other)
+			return *this;
+
+		release();
+		control_ = other.control_;
+		first_ = other.first_;
+		size_ = other.size_;
+		other.nullify();
+		return *this;
+	}
+
+	void swap(buffer_slice &other) noexcept
+	{
+		using std::swap;
+		swap(control_, other.control_);
+		swap(first_, other.first_);
+		swap(size_, other.size_);
+	}
+
+	const T *data() const noexcept { return first_; }
+	size_type size() const noexcept { return size_; }
+	bool empty() const noexcept { return size_ == 0; }
+
+	const_reference operator[](size_type ix) const { return first_[ix]; }
+
+	const_reference at(size_type ix) const
+	{
+		if (ix < size_)
+			return first_[ix];
+		throw std::out_of_range("Out of range");
+	}
+
+	const_iterator begin() const noexcept { return first_; }
+	const_iterator end() const noexcept { return first_ + size_; }
+
+	///The number of slices, including this one, that share the buffer.
+	size_type use_count() const noexcept { return control_ ? control_->use_count() : 0; }
+
+	///Returns a slice of up to `count` elements starting at `pos`, sharing the same buffer.
+	///`count` is clamped to the end of this slice.
+	///Throws `std::out_of_range` if `pos` is past the end.
+	buffer_slice subslice(size_type pos, size_type count) const
+	{
+		if (pos > size_)
+			throw std::out_of_range("Out of range");
+
+		if (count > size_ - pos)
+			count = size_ - pos;
+
+		if (control_)
+			control_->acquire();
+		return buffer_slice(control_, first_ + pos, count);
+	}
+
+	///Copies the elements of the slice into a new vector.
+	my_vector<T> to_vector() const &
+	{
+		return my_vector<T>(begin(), end());
+	}
+
+	///Returns the elements of the slice as a vector.
+	///If this is the only reference to the buffer, and it spans the whole buffer,
+	///the buffer itself is moved out instead of being copied.
+	my_vector<T> to_vector() &&
+	{
+		if (control_ && control_->use_count() == 1 &&
+			first_ == control_->values.data() && size_ == control_->values.size())
+		{
+			my_vector<T> values(std::move(control_->values));
+			release();
+			nullify();
+			return values;
+		}
+
+		return static_cast<const buffer_slice&>(*this).to_vector();
+	}
+
+private:
+	template<typename, bool>
+	friend class shared_buffer;
+
+	using control_type = detail::buffer_control<T, Atomic>;
+
+	control_type *control_;
+	const T *first_;
+	size_type size_;
+
+	//Adopts a reference that has already been acquired.
+	buffer_slice(control_type *control, const T *first, size_type size) noexcept
+		: control_(control), first_(first), size_(size) {}
+
+	void release() noexcept
+	{
+		if (control_ && control_->release())
+			delete control_;
+	}
+
+	void nullify() noexcept
+	{
+		control_ = nullptr;
+		first_ = nullptr;
+		size_ = 0;
+	}
+};
+
+///Takes ownership of a vector's buffer and hands out immutable, reference-counted slices of it.
+///With `Atomic` set, slices can be copied and destroyed concurrently from different threads.
+///Slices point directly into the buffer, so for trivially copyable `T`,
+///`data()`/`size()` can be passed straight to the `vector_tools` copy and relocation primitives.
+template<typename T, bool Atomic = true>
+class shared_buffer
+{
+public:
+	using value_type = T;
+	using size_type = std::size_t;
+	using slice = buffer_slice<T, Atomic>;
+
+	shared_buffer() = default;
+
+	///Takes the buffer from `vec`, without copying its elements.
+	explicit shared_buffer(my_vector<T> &&vec)
+		: whole_(new detail::buffer_control<T, Atomic>(std::move(vec)), nullptr, 0)
+	{
+		whole_.first_ = whole_.control_->values.data();
+		whole_.size_ = whole_.control_->values.size();
+	}
+
+	const T *data() const noexcept { return whole_.data(); }
+	size_type size() const noexcept { return whole_.size(); }
+	bool empty() const noexcept { return whole_.empty(); }
+	size_type use_count() const noexcept { return whole_.use_count(); }
+
+	///A slice spanning the whole buffer.
+	const slice &all() const noexcept { return whole_; }
+
+	///Returns a slice of up to `count` elements starting at `pos`.
+	slice subslice(size_type pos, size_type count) const
+	{
+		return whole_.subslice(pos, count);
+	}
+
+	///Returns the buffer as a vector, moving it out if no slices remain.
+	my_vector<T> to_vector() &&
+	{
+		return std::move(whole_).to_vector();
+	}
+
+	my_vector<T> to_vector() const &
+	{
+		return whole_.to_vector();
+	}
+
+private:
+	slice whole_;
+};
+
+#endif //SHARED_BUFFER_HEADER
@@ -0,0 +1,468 @@
+#ifndef SHM_RING_HEADER
+#define SHM_RING_HEADER
+
+#if !defined(__linux__)
+#error "shm_ring requires Linux (shm_open/memfd_create, mmap and futex)."
+#endif
+
+#include "my_vector.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace detail
+{
+	//Waits until `*word` no longer holds `expected`, or until woken.
+	//Spurious wakeups are possible; callers re-check their condition.
+	inline void futex_wait(std::atomic<std::uint32_t> &word, std::uint32_t expected) noexcept
+	{
+		static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t),
+			"futex words must be plain 32-bit integers.");
+		syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAIT, expected, nullptr, nullptr, 0);
+	}
+
+	inline void futex_wake_all(std::atomic<std::uint32_t> &word) noexcept
+	{
+		syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+	}
+
+	//A futex word that is bumped each time the condition being waited on may have changed.
+	//Waiters are counted, so that signalling costs no syscall when nobody is asleep.
+	struct shm_ring_signal
+	{
+		std::atomic<std::uint32_t> sequence;
+		std::atomic<std::uint32_t> waiters;
+
+		void notify() noexcept
+		{
+			sequence.fetch_add(1);
+			if (waiters.load() != 0)
+				futex_wake_all(sequence);
+		}
+
+		//Sleeps until notified, unless `ready()` becomes true first.
+		template<typename Pred>
+		void wait(Pred ready) noexcept
+		{
+			auto seq = sequence.load();
+			waiters.fetch_add(1);
+			if (!ready())
+				futex_wait(sequence, seq);
+			waiters.fetch_sub(1);
+		}
+	};
+
+	//The control block at the start of the shared mapping.
+	//The producer and consumer halves live on separate cache lines.
+	struct shm_ring_header
+	{
+		std::uint64_t magic;
+		std::uint64_t capacity;
+		std::uint64_t element_size;
+		std::atomic<std::uint32_t> closed;
+
+		//Written by the producer.
+		alignas(64) std::atomic<std::uint64_t> head;
+		shm_ring_signal data;
+
+		//Written by the consumer.
+		alignas(64) std::atomic<std::uint64_t> tail;
+		shm_ring_signal space;
+	};
+
+	constexpr std::uint64_t shm_ring_magic = 0x676e69725f6d6873; //"shm_ring"
+
+	//Slots start on their own cache line after the header.
+	constexpr std::size_t shm_ring_slots_offset = (sizeof(shm_ring_header) + 63) & ~std::size_t(63);
+
+	[[noreturn]] inline void throw_errno(const char *what)
+	{
+		throw std::system_error(errno, std::generic_category(), what);
+	}
+}
+
+///A single-producer, single-consumer ring of trivially copyable `T`s
+///in memory shared between processes.
+///The ring lives in a POSIX shared memory object (`create`/`open`) or an anonymous
+///memfd (`create_anonymous`/`from_fd`) that can be inherited or passed over a socket.
+///Each batch is copied exactly once, straight between the caller's memory and the ring.
+///Blocking waits sleep on futexes in the shared mapping, and a wakeup syscall is only
+///made when the other side is actually asleep.
+template<typename T>
+class shm_ring
+{
+public:
+	static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable types can be shared between processes.");
+
+	using value_type = T;
+	using size_type = std::size_t;
+
+	///A contiguous run of readable elements, still owned by the ring until `consume` is called.
+	struct read_view
+	{
+		const T *first;
+		size_type count;
+
+		const T *begin() const noexcept { return first; }
+		const T *end() const noexcept { return first + count; }
+		bool empty() const noexcept { return count == 0; }
+	};
+
+	///Creates and maps a new named shared memory object holding a ring of `capacity` elements.
+	///`capacity` is rounded up to a power of two.
+	///Throws `std::system_error` if the object already exists or cannot be created.
+	static shm_ring create(const char *name, size_type capacity)
+	{
+		int fd = ::shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+		if (fd < 0)
+			detail::throw_errno("shm_open");
+
+		try
+		{
+			return shm_ring(fd, capacity);
+		}
+		catch (...)
+		{
+			::shm_unlink(name);
+			throw;
+		}
+	}
+
+	///Maps an existing named ring, created by `create` in another process.
+	static shm_ring open(const char *name)
+	{
+		int fd = ::shm_open(name, O_RDWR, 0);
+		if (fd < 0)
+			detail::throw_errno("shm_open");
+
+		return shm_ring(fd);
+	}
+
+	///Removes the name of a shared memory object. Existing mappings remain valid.
+	static void remove(const char *name) noexcept
+	{
+		::shm_unlink(name);
+	}
+
+	///Creates a ring in an anonymous memfd. Share it by forking, or by sending `fd()` over a socket.
+	static shm_ring create_anonymous(size_type capacity)
+	{
+		int fd = ::memfd_create("shm_ring", MFD_CLOEXEC);
+		if (fd < 0)
+			detail::throw_errno("memfd_create");
+
+		return shm_ring(fd, capacity);
+	}
+
+	///Maps the ring in `fd`, which must have been set up by `create_anonymous` or `create`.
+	///The ring takes ownership of `fd`.
+	static shm_ring from_fd(int fd)
+	{
+		return shm_ring(fd);
+	}
+
+	shm_ring(shm_ring &&other) noexcept
+		: fd_(other.fd_), mapping_(other.mapping_), mapping_size_(other.mapping_size_)
+		, header_(other.header_), slots_(other.slots_), mask_(other.mask_)
+		, cached_head_(other.cached_head_), cached_tail_(other.cached_tail_)
+	{
+		other.nullify();
+	}
+
+	shm_ring &operator=(shm_ring &&other) noexcept
+	{
+		if (this == &other)
+			return *this;
+
+		unmap();
+		fd_ = other.fd_;
+		mapping_ = other.mapping_;
+		mapping_size_ = other.mapping_size_;
+		header_ = other.header_;
+		slots_ = other.slots_;
+		mask_ = other.mask_;
+		cached_head_ = other.cached_head_;
+		cached_tail_ = other.cached_tail_;
+		other.nullify();
+		return *this;
+	}
+
+	~shm_ring()
+	{
+		unmap();
+	}
+
+	int fd() const noexcept { return fd_; }
+	size_type capacity() const noexcept { return mask_ + 1; }
+
+	///Marks the ring as closed and wakes both sides.
+	///Blocking pops return 0 once a closed ring is empty; blocking pushes stop early.
+	void close() noexcept
+	{
+		header_->closed.store(1);
+		header_->data.notify();
+		header_->space.notify();
+	}
+
+	bool closed() const noexcept { return header_->closed.load() != 0; }
+
+	//Producer side.
+
+	///Copies as many elements of `first/first + count` as fit into the ring, without waiting.
+	///Returns the number of elements pushed.
+	size_type try_push_range(const T *first, size_type count) noexcept
+	{
+		auto head = header_->head.load(std::memory_order_relaxed);
+		auto free_slots = capacity() - size_type(head - cached_tail_);
+		if (free_slots < count)
+		{
+			cached_tail_ = header_->tail.load(std::memory_order_acquire);
+			free_slots = capacity() - size_type(head - cached_tail_);
+		}
+
+		count = std::min(count, free_slots);
+		if (count == 0)
+			return 0;
+
+		//Copy in at most two parts, around the wrap point.
+		auto start = size_type(head) & mask_;
+		auto part = std::min(count, capacity() - start);
+		std::memcpy(slots_ + start, first, part * sizeof(T));
+		std::memcpy(slots_, first + part, (count - part) * sizeof(T));
+
+		header_->head.store(head + count, std::memory_order_release);
+		header_->data.notify();
+		return count;
+	}
+
+	///Copies all of `first/first + count` into the ring, waiting for space as needed.
+	///Returns the number of elements pushed, which is less than `count` only if the ring was closed.
+	size_type push_range(const T *first, size_type count) noexcept
+	{
+		size_type pushed = 0;
+		while (pushed != count && !closed())
+		{
+			pushed += try_push_range(first + pushed, count - pushed);
+			if (pushed != count)
+				header_->space.wait([this] { return has_space() || closed(); });
+		}
+
+		return pushed;
+	}
+
+	//Consumer side.
+
+	///Appends up to `max_count` available elements to `out`, without waiting.
+	///`out` is grown at most once, geometrically, and the elements are copied directly from the ring into it.
+	///Returns the number of elements popped.
+	size_type try_pop_into(my_vector<T> &out, size_type max_count)
+	{
+		auto tail = header_->tail.load(std::memory_order_relaxed);
+		auto count = std::min(available(tail, max_count), max_count);
+		if (count == 0)
+			return 0;
+
+		auto start = size_type(tail) & mask_;
+		auto part = std::min(count, capacity() - start);
+		if (out.capacity() - out.size() < count)
+			out.reserve(std::max(out.size() + count, out.capacity() + out.capacity() / 2));
+		out.insert(out.end(), slots_ + start, slots_ + start + part);
+		out.insert(out.end(), slots_, slots_ + (count - part));
+
+		release_slots(tail + count);
+		return count;
+	}
+
+	///Appends up to `max_count` elements to `out`, waiting until at least one is available.
+	///Returns 0 only if the ring is closed and empty.
+	size_type pop_into(my_vector<T> &out, size_type max_count)
+	{
+		while (true)
+		{
+			if (auto count = try_pop_into(out, max_count))
+				return count;
+			if (closed() && !has_data())
+				return 0;
+
+			header_->data.wait([this] { return has_data() || closed(); });
+		}
+	}
+
+	///Returns the longest contiguous run of readable elements, without copying or waiting.
+	///The elements stay in the ring until `consume` releases them.
+	read_view peek() noexcept
+	{
+		auto tail = header_->tail.load(std::memory_order_relaxed);
+		auto start = size_type(tail) & mask_;
+		auto count = std::min(available(tail, capacity() - start), capacity() - start);
+		return { slots_ + start, count };
+	}
+
+	///As `peek`, but waits until at least one element is readable.
+	///Returns an empty view only if the ring is closed and empty.
+	read_view wait_peek() noexcept
+	{
+		while (true)
+		{
+			auto view = peek();
+			if (!view.empty() || (closed() && !has_data()))
+				return view;
+
+			header_->data.wait([this] { return has_data() || closed(); });
+		}
+	}
+
+	///Releases `count` elements previously returned by `peek` back to the producer.
+	void consume(size_type count) noexcept
+	{
+		release_slots(header_->tail.load(std::memory_order_relaxed) + count);
+	}
+
+private:
+	int fd_;
+	void *mapping_;
+	size_type mapping_size_;
+	detail::shm_ring_header *header_;
+	T *slots_;
+	size_type mask_;
+	//Each side's last view of the other's index, to avoid touching its cache line on every call.
+	std::uint64_t cached_head_;
+	std::uint64_t cached_tail_;
+
+	//Sizes `fd` for `capacity` elements, maps it and initializes the header.
+	shm_ring(int fd, size_type capacity)
+		: fd_(fd)
+	{
+		size_type rounded = 1;
+		while (rounded < capacity)
+			rounded *= 2;
+
+		auto size = detail::shm_ring_slots_offset + rounded * sizeof(T);
+		if (::ftruncate(fd, off_t(size)) != 0)
+		{
+			::close(fd);
+			detail::throw_errno("ftruncate");
+		}
+
+		map(size);
+		header_->capacity = rounded;
+		header_->element_size = sizeof(T);
+		header_->closed.store(0);
+		header_->head.store(0);
+		header_->data.sequence.store(0);
+		header_->data.waiters.store(0);
+		header_->tail.store(0);
+		header_->space.sequence.store(0);
+		header_->space.waiters.store(0);
+		std::atomic_thread_fence(std::memory_order_release);
+		header_->magic = detail::shm_ring_magic;
+		init_indices();
+	}
+
+	//Maps an already initialized ring in `fd`.
+	explicit shm_ring(int fd)
+		: fd_(fd)
+	{
+		struct stat info;
+		if (::fstat(fd, &info) != 0)
+		{
+			::close(fd);
+			detail::throw_errno("fstat");
+		}
+
+		map(size_type(info.st_size));
+		if (mapping_size_ < detail::shm_ring_slots_offset || header_->magic != detail::shm_ring_magic ||
+			header_->element_size != sizeof(T) ||
+			detail::shm_ring_slots_offset + header_->capacity * sizeof(T) > mapping_size_)
+		{
+			unmap();
+			throw std::invalid_argument("shm_ring: not a ring of this element type");
+		}
+
+		init_indices();
+	}
+
+	void map(size_type size)
+	{
+		mapping_ = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+		if (mapping_ == MAP_FAILED)
+		{
+			::close(fd_);
+			detail::throw_errno("mmap");
+		}
+
+		mapping_size_ = size;
+		header_ = static_cast<detail::shm_ring_header*>(mapping_);
+		slots_ = reinterpret_cast<T*>(static_cast<unsigned char*>(mapping_) + detail::shm_ring_slots_offset);
+	}
+
+	void init_indices() noexcept
+	{
+		mask_ = size_type(header_->capacity) - 1;
+		cached_head_ = header_->head.load();
+		cached_tail_ = header_->tail.load();
+	}
+
+	void unmap() noexcept
+	{
+		if (mapping_)
+		{
+			::munmap(mapping_, mapping_size_);
+			::close(fd_);
+		}
+		nullify();
+	}
+
+	void nullify() noexcept
+	{
+		fd_ = -1;
+		mapping_ = nullptr;
+		mapping_size_ = 0;
+		header_ = nullptr;
+		slots_ = nullptr;
+		mask_ = 0;
+		cached_head_ = 0;
+		cached_tail_ = 0;
+	}
+
+	//The number of readable elements, refreshing the cached head only when it shows fewer than `wanted`.
+	size_type available(std::uint64_t tail, size_type wanted) noexcept
+	{
+		if (size_type(cached_head_ - tail) < wanted)
+			cached_head_ = header_->head.load(std::memory_order_acquire);
+		return size_type(cached_head_ - tail);
+	}
+
+	bool has_data() const noexcept
+	{
+		return header_->head.load() != header_->tail.load();
+	}
+
+	bool has_space() const noexcept
+	{
+		return header_->head.load() - header_->tail.load() < capacity();
+	}
+
+	void release_slots(std::uint64_t new_tail) noexcept
+	{
+		header_->tail.store(new_tail, std::memory_order_release);
+		header_->space.notify();
+	}
+};
+
+#endif //SHM_RING_HEADER
@@ -0,0 +1,311 @@
+#ifndef VECTOR_TOOLS_SMALL_SORT_HEADER
+#define VECTOR_TOOLS_SMALL_SORT_HEADER
+
+#include "my_vector.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace vector_tools
+{
+	///The most elements a sorting network is built for.
+	constexpr std::size_t sorting_network_limit = 64;
+
+	///The most elements `vector_tools::sort` hands to a sorting network rather than `std::sort`.
+	constexpr std::size_t small_sort_threshold = 64;
+
+	namespace detail
+	{
+		///The comparators of Batcher's odd-even merge sort for `n` elements, in the order they are applied:
+		///each sorts the pair at `lo[ix]` and `hi[ix]`. For `n` other than a power of two, this is the network
+		///for the next power of two with the comparators past the end dropped, which is the same
+		///as sorting with infinite padding that never moves.
+		struct sorting_network
+		{
+			my_vector<std::uint8_t> lo;
+			my_vector<std::uint8_t> hi;
+
+			std::size_t size() const noexcept { return lo.size(); }
+		};
+
+		inline sorting_network make_sorting_network(std::size_t n)
+		{
+			sorting_network out;
+			for (std::size_t p = 1; p < n; p *= 2)
+			{
+				for (auto k = p; k >= 1; k /= 2)
+				{
+					for (auto j = k % p; j + k < n; j += 2 * k)
+					{
+						for (std::size_t i = 0; i < k && i + j + k < n; ++i)
+						{
+							if ((i + j) / (p * 2) == (i + j + k) / (p * 2))
+							{
+								out.lo.push_back(std::uint8_t(i + j));
+								out.hi.push_back(std::uint8_t(i + j + k));
+							}
+						}
+					}
+				}
+			}
+			return out;
+		}
+
+		///The network for `n` elements, `n <= sorting_network_limit`. All are built on first use.
+		inline const sorting_network &sorting_network_for(std::size_t n)
+		{
+			static const my_vector<sorting_network> networks = [] {
+				my_vector<sorting_network> out;
+				out.reserve(sorting_network_limit + 1);
+				for (std::size_t size = 0; size <= sorting_network_limit; ++size)
+					out.push_back(make_sorting_network(size));
+				return out;
+			}();
+			return networks[n];
+		}
+
+		//Sorts `a` and `b` with selects rather than a branch, which compile to min/max or conditional moves.
+		//Values that are unordered, such as NaNs, are left where they are.
+		template<typename T>
+		void compare_exchange(T &a, T &b) noexcept
+		{
+			auto x = a;
+			auto y = b;
+			bool swap = y < x;
+			a = swap ? y : x;
+			b = swap ? x : y;
+		}
+
+		//As above, ordering by key and then by value.
+		template<typename K, typename V>
+		void compare_exchange(K &key_a, K &key_b, V &value_a, V &value_b) noexcept
+		{
+			auto kx = key_a;
+			auto ky = key_b;
+			auto vx = value_a;
+			auto vy = value_b;
+			bool swap = (ky < kx) | ((!(kx < ky)) & (vy < vx));
+			key_a = swap ? ky : kx;
+			key_b = swap ? kx : ky;
+			value_a = swap ? vy : vx;
+			value_b = swap ? vx : vy;
+		}
+
+		template<typename T>
+		void check_network_size(std::size_t n)
+		{
+			static_assert(std::is_arithmetic<T>::value, "Sorting networks are only for arithmetic types.");
+			if (n > sorting_network_limit)
+				throw std::invalid_argument("Too many elements for a sorting network");
+		}
+	}
+
+	///Sorts `first/last`, at most `sorting_network_limit` arithmetic values, with a sorting network.
+	///The network does the same compare-exchanges whatever the data, with no branches to mispredict.
+	template<typename T>
+	void network_sort(T *first, T *last)
+	{
+		auto n = std::size_t(last - first);
+		detail::check_network_size<T>(n);
+
+		auto &net = detail::sorting_network_for(n);
+		for (std::size_t ix = 0; ix != net.size(); ++ix)
+			detail::compare_exchange(first[net.lo[ix]], first[net.hi[ix]]);
+	}
+
+	///Sorts the `n` keys at `keys`, at most `sorting_network_limit` of them, and permutes the values at `values`
+	///to match. Equal keys are ordered by value, so with values that are the keys' original positions,
+	///the sort is stable.
+	template<typename K, typename V>
+	void network_sort_by_key(K *keys, V *values, std::size_t n)
+	{
+		detail::check_network_size<K>(n);
+		static_assert(std::is_arithmetic<V>::value, "Sorting networks are only for arithmetic types.");
+
+		auto &net = detail::sorting_network_for(n);
+		for (std::size_t ix = 0; ix != net.size(); ++ix)
+		{
+			auto lo = net.lo[ix];
+			auto hi = net.hi[ix];
+			detail::compare_exchange(keys[lo], keys[hi], values[lo], values[hi]);
+		}
+	}
+
+	namespace detail
+	{
+		template<typename T>
+		void sort(T *first, T *last, std::true_type)
+		{
+			if (std::size_t(last - first) <= small_sort_threshold)
+				network_sort(first, last);
+			else
+				std::sort(first, last);
+		}
+
+		template<typename T>
+		void sort(T *first, T *last, std::false_type)
+		{
+			std::sort(first, last);
+		}
+	}
+
+	///Sorts `first/last`: with a sorting network if the values are arithmetic and there are at most
+	///`small_sort_threshold` of them, where `std::sort`'s setup costs more than the sorting; otherwise with `std::sort`.
+	template<typename T>
+	void sort(T *first, T *last)
+	{
+		detail::sort(first, last, std::is_arithmetic<T>{});
+	}
+
+	template<typename T, typename Alloc>
+	void sort(my_vector<T, Alloc> &vec)
+	{
+		sort(vec.data(), vec.data() + vec.size());
+	}
+
+	namespace detail
+	{
+		//Sorts a permutation of the positions, then applies it.
+		template<typename K, typename V>
+		void sort_by_key(K *keys, V *values, std::size_t n, std::false_type)
+		{
+			my_vector<std::size_t> order(n);
+			for (std::size_t ix = 0; ix != n; ++ix)
+				order[ix] = ix;
+			std::sort(order.begin(), order.end(), [&](std::size_t lhs, std::size_t rhs) {
+				if (keys[lhs] < keys[rhs])
+					return true;
+				if (keys[rhs] < keys[lhs])
+					return false;
+				return values[lhs] < values[rhs];
+			});
+
+			my_vector<K> sorted_keys;
+			my_vector<V> sorted_values;
+			sorted_keys.reserve(n);
+			sorted_values.reserve(n);
+			for (auto ix : order)
+			{
+				sorted_keys.push_back(std::move(keys[ix]));
+				sorted_values.push_back(std::move(values[ix]));
+			}
+			std::move(sorted_keys.begin(), sorted_keys.end(), keys);
+			std::move(sorted_values.begin(), sorted_values.end(), values);
+		}
+
+		template<typename K, typename V>
+		void sort_by_key(K *keys, V *values, std::size_t n, std::true_type)
+		{
+			if (n <= small_sort_threshold)
+				network_sort_by_key(keys, values, n);
+			else
+				sort_by_key(keys, values, n, std::false_type{});
+		}
+	}
+
+	///Sorts `keys`, permuting `values` to match; equal keys are ordered by value.
+	///Small arithmetic inputs use a sorting network; others sort a permutation and apply it.
+	template<typename K, typename V, typename KAlloc, typename VAlloc>
+	void sort_by_key(my_vector<K, KAlloc> &keys, my_vector<V, VAlloc> &values)
+	{
+		if (keys.size() != values.size())
+			throw std::invalid_argument("sort_by_key: keys and values differ in length");
+
+		detail::sort_by_key(keys.data(), values.data(), keys.size(), std::integral_constant<bool,
+			std::is_arithmetic<K>::value && std::is_arithmetic<V>::value>{});
+	}
+
+	namespace detail
+	{
+		//Vectors sorted side by side in one pass of a network: one per lane.
+		constexpr std::size_t sort_batch_lanes = 32;
+
+		//Sorts up to `sort_batch_lanes` vectors of `n` elements each.
+		//They are transposed so that element `ix` of every vector is contiguous; each compare-exchange
+		//of the network then runs across all the lanes at once, as a loop the compiler vectorizes.
+		template<typename T, typename Alloc>
+		void sort_lanes(my_vector<T, Alloc> *const *group, std::size_t count, std::size_t n, T *buffer)
+		{
+			for (std::size_t lane = 0; lane != count; ++lane)
+			{
+				auto values = group[lane]->data();
+				for (std::size_t ix = 0; ix != n; ++ix)
+					buffer[ix * sort_batch_lanes + lane] = values[ix];
+			}
+
+			auto &net = sorting_network_for(n);
+			for (std::size_t cmp = 0; cmp != net.size(); ++cmp)
+			{
+				auto lo = buffer + net.lo[cmp] * sort_batch_lanes;
+				auto hi = buffer + net.hi[cmp] * sort_batch_lanes;
+
+				//Staged through locals, which the compiler knows cannot alias each other,
+				//with one loop per output, which it vectorizes at -O2 as well as -O3.
+				T x[sort_batch_lanes];
+				T y[sort_batch_lanes];
+				std::copy(lo, lo + sort_batch_lanes, x);
+				std::copy(hi, hi + sort_batch_lanes, y);
+				for (std::size_t lane = 0; lane != sort_batch_lanes; ++lane)
+					lo[lane] = y[lane] < x[lane] ? y[lane] : x[lane];
+				for (std::size_t lane = 0; lane != sort_batch_lanes; ++lane)
+					hi[lane] = y[lane] < x[lane] ? x[lane] : y[lane];
+			}
+
+			for (std::size_t lane = 0; lane != count; ++lane)
+			{
+				auto values = group[lane]->data();
+				for (std::size_t ix = 0; ix != n; ++ix)
+					values[ix] = buffer[ix * sort_batch_lanes + lane];
+			}
+		}
+	}
+
+	///Sorts each of `vectors`. Small arithmetic vectors are grouped by length and sorted
+	///`sort_batch_lanes` at a time by running one sorting network across them all; larger ones use `std::sort`.
+	template<typename T, typename Alloc, typename OuterAlloc>
+	void sort_batch(my_vector<my_vector<T, Alloc>, OuterAlloc> &vectors)
+	{
+		static_assert(std::is_arithmetic<T>::value, "Batched sorting is only for arithmetic types.");
+
+		//Bucket the small vectors by length, so each bucket shares a network.
+		my_vector<std::size_t> counts(sorting_network_limit + 2);
+		for (auto &vec : vectors)
+		{
+			if (vec.size() <= sorting_network_limit)
+				++counts[vec.size() + 1];
+			else
+				std::sort(vec.begin(), vec.end());
+		}
+
+		for (std::size_t n = 1; n != counts.size(); ++n)
+			counts[n] += counts[n - 1];
+
+		my_vector<my_vector<T, Alloc>*> by_size(counts.back());
+		for (auto &vec : vectors)
+		{
+			if (vec.size() <= sorting_network_limit)
+				by_size[counts[vec.size()]++] = &vec;
+		}
+
+		my_vector<T> buffer(sorting_network_limit * detail::sort_batch_lanes);
+		std::size_t begin = 0;
+		for (std::size_t n = 0; n <= sorting_network_limit; ++n)
+		{
+			auto end = counts[n];
+			if (n >= 2)
+			{
+				for (auto first = begin; first < end; first += detail::sort_batch_lanes)
+				{
+					auto count = std::min(detail::sort_batch_lanes, end - first);
+					detail::sort_lanes(by_size.data() + first, count, n, buffer.data());
+				}
+			}
+			begin = end;
+		}
+	}
+}
+
+#endif //VECTOR_TOOLS_SMALL_SORT_HEADER
@@ -0,0 +1,224 @@
+#ifndef SPECULATIVE_ALLOCATOR_HEADER
+#define SPECULATIVE_ALLOCATOR_HEADER
+
+#include "my_vector.hpp"
+#include <chrono>
+#include <cstddef>
+#include <future>
+#include <memory>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace detail
+{
+	///The in-flight buffer of one `speculative_allocator`.
+	struct speculation_state
+	{
+		~speculation_state()
+		{
+			discard();
+		}
+
+		//The buffer being prepared, and its size in bytes.
+		std::future<void*> pending;
+		std::size_t pending_bytes = 0;
+
+		//Allocates `bytes` on another thread, touching every page so that it is resident before use.
+		void prepare(std::size_t bytes)
+		{
+			discard();
+			pending = std::async(std::launch::async, [bytes] {
+				auto buffer = static_cast<volatile char*>(::operator new(bytes));
+				for (std::size_t offset = 0; offset < bytes; offset += page_size)
+					buffer[offset] = 0;
+				return const_cast<void*>(static_cast<volatile void*>(buffer));
+			});
+			pending_bytes = bytes;
+		}
+
+		//Returns the prepared buffer if it is `bytes` long, waiting for it if need be.
+		//Returns NULL, and discards any other prepared buffer without waiting for it, if it is not.
+		void *take(std::size_t bytes) noexcept
+		{
+			if (!pending.valid())
+				return nullptr;
+
+			if (bytes != pending_bytes)
+			{
+				discard();
+				return nullptr;
+			}
+
+			pending_bytes = 0;
+			try
+			{
+				return pending.get();
+			}
+			catch (...)
+			{
+				//The helper failed to allocate; let the caller try for itself.
+				return nullptr;
+			}
+		}
+
+		//Frees the prepared buffer. If the helper is still making it, a detached thread
+		//waits for it and frees it, so that the caller does not wait for a buffer it will not use.
+		void discard() noexcept
+		{
+			if (!pending.valid())
+				return;
+
+			pending_bytes = 0;
+			if (pending.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			{
+				std::shared_ptr<std::future<void*>> stale;
+				try
+				{
+					stale = std::make_shared<std::future<void*>>(std::move(pending));
+					std::thread([stale] { free_result(*stale); }).detach();
+					return;
+				}
+				catch (...)
+				{
+					//There is no thread to hand it to, so wait for it here after all.
+					if (stale)
+					{
+						free_result(*stale);
+						return;
+					}
+				}
+			}
+
+			free_result(pending);
+		}
+
+		static void free_result(std::future<void*> &result) noexcept
+		{
+			try
+			{
+				::operator delete(result.get());
+			}
+			catch (...)
+			{
+				//The helper failed to allocate, so there is nothing to free.
+			}
+		}
+
+		//Pre-faulting one byte in every 4KiB also covers larger pages.
+		static constexpr std::size_t page_size = 4096;
+
+		//With a single hardware thread, the helper could only take time from the vector's own thread.
+		static bool helper_can_overlap()
+		{
+			static const bool result = std::thread::hardware_concurrency() > 1;
+			return result;
+		}
+	};
+}
+
+///An allocator that makes `my_vector` prepare its next buffer before it is needed.
+///Once an append leaves the storage at least `fill_ratio` full, and the next buffer
+///`calc_expanded_capacity` would ask for is at least `min_bytes`, that buffer is
+///allocated and pre-faulted on a helper thread. When the vector does grow, the allocation
+///returns that buffer, already resident, and only the relocation is left to do.
+///Smaller vectors, vectors that grow by other means, and machines with a single hardware thread
+///allocate as usual.
+///Each allocator has at most one buffer in flight. Moving the allocator, as moving or swapping
+///the vector does, takes that buffer along; copies get the settings only.
+template<typename T>
+class speculative_allocator
+{
+public:
+	using value_type = T;
+	using propagate_on_container_move_assignment = std::true_type;
+	using propagate_on_container_swap = std::true_type;
+	using is_always_equal = std::true_type;
+
+	template<typename U>
+	struct rebind { using other = speculative_allocator<U>; };
+
+	explicit speculative_allocator(double fill_ratio = 0.9, std::size_t min_bytes = std::size_t(1) << 20) noexcept
+		: fill_ratio_(fill_ratio), min_bytes_(min_bytes) {}
+
+	template<typename U>
+	speculative_allocator(const speculative_allocator<U> &other) noexcept
+		: fill_ratio_(other.fill_ratio()), min_bytes_(other.min_bytes()) {}
+
+	speculative_allocator(const speculative_allocator &other) noexcept
+		: fill_ratio_(other.fill_ratio_), min_bytes_(other.min_bytes_) {}
+
+	speculative_allocator(speculative_allocator &&other) noexcept = default;
+
+	speculative_allocator &operator=(const speculative_allocator &other) noexcept
+	{
+		fill_ratio_ = other.fill_ratio_;
+		min_bytes_ = other.min_bytes_;
+		state_.reset();
+		return *this;
+	}
+
+	speculative_allocator &operator=(speculative_allocator &&other) noexcept = default;
+
+	double fill_ratio() const noexcept { return fill_ratio_; }
+	std::size_t min_bytes() const noexcept { return min_bytes_; }
+
+	T *allocate(std::size_t count)
+	{
+		auto bytes = count * sizeof(T);
+		if (state_)
+		{
+			if (auto buffer = state_->take(bytes))
+				return static_cast<T*>(buffer);
+		}
+
+		return static_cast<T*>(::operator new(bytes));
+	}
+
+	void deallocate(T *ptr, std::size_t) noexcept
+	{
+		::operator delete(ptr);
+	}
+
+	///Called by `my_vector` after each append.
+	void growth_hint(std::size_t size, std::size_t capacity, std::size_t next_capacity) noexcept
+	{
+		if (size < capacity * fill_ratio_)
+			return;
+
+		auto bytes = next_capacity * sizeof(T);
+		if (bytes < min_bytes_ || (state_ && state_->pending_bytes == bytes) ||
+			!detail::speculation_state::helper_can_overlap())
+		{
+			return;
+		}
+
+		try
+		{
+			if (!state_)
+				state_.reset(new detail::speculation_state());
+			state_->prepare(bytes);
+		}
+		catch (...)
+		{
+			//No memory or thread to spare; the vector will allocate when it grows, as usual.
+		}
+	}
+
+	template<typename U>
+	bool operator==(const speculative_allocator<U> &) const noexcept { return true; }
+
+	template<typename U>
+	bool operator!=(const speculative_allocator<U> &) const noexcept { return false; }
+
+private:
+	double fill_ratio_;
+	std::size_t min_bytes_;
+	std::unique_ptr<detail::speculation_state> state_;
+};
+
+template<typename T>
+using speculative_vector = my_vector<T, speculative_allocator<T>>;
+
+#endif //SPECULATIVE_ALLOCATOR_HEADER
@@ -0,0 +1,382 @@
+#ifndef TIMESERIES_STORE_HEADER
+#define TIMESERIES_STORE_HEADER
+
+#include "my_vector.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+
+namespace detail
+{
+	///The type values are summed in: 64-bit integers for integers, `double` otherwise.
+	template<typename Value>
+	using series_sum_t = std::conditional_t<std::is_integral<Value>::value,
+		std::conditional_t<std::is_signed<Value>::value, std::int64_t, std::uint64_t>, double>;
+}
+
+///Count, sum and extremes of some of the values in a `time_series_store`.
+///`min` and `max` are meaningless when `count` is 0.
+template<typename Value>
+struct series_summary
+{
+	std::size_t count = 0;
+	detail::series_sum_t<Value> sum = 0;
+	Value min = Value();
+	Value max = Value();
+
+	void merge(const series_summary &other) noexcept
+	{
+		if (other.count == 0)
+			return;
+
+		min = count == 0 ? other.min : std::min(min, other.min);
+		max = count == 0 ? other.max : std::max(max, other.max);
+		count += other.count;
+		sum += other.sum;
+	}
+};
+
+///A sealed chunk of a `time_series_store`: a column of timestamps, a column of values,
+///and a zone map giving the range of each column and the chunk's summary.
+///Once sealed, a chunk never changes.
+template<typename Value, typename Timestamp>
+class series_chunk
+{
+public:
+	using size_type = std::size_t;
+
+	const my_vector<Timestamp> &timestamps() const noexcept { return timestamps_; }
+	const my_vector<Value> &values() const noexcept { return values_; }
+	size_type size() const noexcept { return timestamps_.size(); }
+
+	Timestamp time_min() const noexcept { return time_min_; }
+	Timestamp time_max() const noexcept { return time_max_; }
+	Value value_min() const noexcept { return summary_.min; }
+	Value value_max() const noexcept { return summary_.max; }
+	const series_summary<Value> &summary() const noexcept { return summary_; }
+
+	///True if the rows were appended in order of time, which lets a scan binary-search its bounds.
+	bool time_ordered() const noexcept { return time_ordered_; }
+
+private:
+	template<typename, typename>
+	friend class time_series_store;
+
+	my_vector<Timestamp> timestamps_;
+	my_vector<Value> values_;
+	Timestamp time_min_ = Timestamp();
+	Timestamp time_max_ = Timestamp();
+	series_summary<Value> summary_;
+	bool time_ordered_ = true;
+
+	void append(Timestamp time, Value value)
+	{
+		timestamps_.push_back(time);
+		values_.push_back(value);
+
+		if (summary_.count == 0)
+		{
+			time_min_ = time_max_ = time;
+			summary_.min = summary_.max = value;
+		}
+		else
+		{
+			time_ordered_ = time_ordered_ && !(time < time_max_);
+			time_min_ = std::min(time_min_, time);
+			time_max_ = std::max(time_max_, time);
+			summary_.min = std::min(summary_.min, value);
+			summary_.max = std::max(summary_.max, value);
+		}
+		++summary_.count;
+		summary_.sum += value;
+	}
+};
+
+///An append-only store of (timestamp, value) rows for one series.
+///Rows are appended to an open chunk, which is sealed once it holds `chunk_rows` rows (or on `flush`).
+///Queries consult each sealed chunk's zone map first: a chunk whose time or value range misses the query
+///is skipped, and one that lies wholly inside it answers aggregate queries from its summary.
+///Only the chunks that straddle a query bound are scanned, with branch-free loops the compiler can vectorize.
+///Rows need not be appended in time order, but chunks that are can be scanned from a binary-searched bound.
+///One thread at a time may append or flush, while any number of threads query. Readers take no locks:
+///sealed chunks are immutable, and each query sees the chunks sealed when it started.
+///Rows in the open chunk are not visible to queries until it is sealed.
+///Values must not be NaN.
+template<typename Value, typename Timestamp = std::int64_t>
+class time_series_store
+{
+public:
+	static_assert(std::is_arithmetic<Value>::value, "Values must be arithmetic.");
+	static_assert(std::is_integral<Timestamp>::value, "Timestamps must be integers.");
+
+	using value_type = Value;
+	using timestamp_type = Timestamp;
+	using size_type = std::size_t;
+	using chunk_type = series_chunk<Value, Timestamp>;
+	using summary_type = series_summary<Value>;
+
+	explicit time_series_store(size_type chunk_rows = 4096)
+		: chunk_rows_(std::max<size_type>(chunk_rows, 1))
+	{
+		auto dir = std::make_unique<directory>();
+		dir->reserve(16);
+		directory_.store(dir.get(), std::memory_order_relaxed);
+		directories_.push_back(std::move(dir));
+	}
+
+	time_series_store(const time_series_store &) = delete;
+	time_series_store &operator=(const time_series_store &) = delete;
+
+	size_type chunk_rows() const noexcept { return chunk_rows_; }
+
+	///Writer: appends a row, sealing the open chunk if this fills it.
+	void append(Timestamp time, Value value)
+	{
+		if (!open_)
+		{
+			open_ = std::make_unique<chunk_type>();
+			open_->timestamps_.reserve(chunk_rows_);
+			open_->values_.reserve(chunk_rows_);
+		}
+
+		open_->append(time, value);
+		if (open_->size() == chunk_rows_)
+			seal();
+	}
+
+	///Writer: seals the open chunk, if it has any rows, making them visible to queries.
+	void flush()
+	{
+		if (open_ && open_->size() != 0)
+			seal();
+	}
+
+	///Writer: the number of rows appended but not yet sealed.
+	size_type pending_rows() const noexcept { return open_ ? open_->size() : 0; }
+
+	///The number of sealed chunks.
+	size_type chunk_count() const noexcept { return sealed_.load(std::memory_order_acquire); }
+
+	///Sealed chunk `ix`, which stays valid for the life of the store.
+	const chunk_type &chunk(size_type ix) const
+	{
+		auto view = snapshot();
+		if (ix >= view.count)
+			throw std::out_of_range("Out of range");
+		return *view.chunks[ix];
+	}
+
+	///The number of rows in sealed chunks.
+	size_type row_count() const noexcept
+	{
+		auto view = snapshot();
+		size_type rows = 0;
+		for (size_type ix = 0; ix != view.count; ++ix)
+			rows += view.chunks[ix]->size();
+		return rows;
+	}
+
+	///Summarizes the values of rows with timestamps in `[from, to)`.
+	summary_type summarize(Timestamp from, Timestamp to) const
+	{
+		summary_type total;
+		auto view = snapshot();
+		for (size_type ix = 0; ix != view.count; ++ix)
+		{
+			auto &curr = *view.chunks[ix];
+			if (!overlaps_time(curr, from, to))
+				continue;
+
+			if (covers_time(curr, from, to))
+				total.merge(curr.summary());
+			else
+				total.merge(scan_summary(curr, from, to));
+		}
+		return total;
+	}
+
+	///The number of rows with timestamps in `[from, to)` and values in `[lo, hi]`.
+	size_type count_where(Timestamp from, Timestamp to, Value lo, Value hi) const
+	{
+		size_type total = 0;
+		auto view = snapshot();
+		for (size_type ix = 0; ix != view.count; ++ix)
+		{
+			auto &curr = *view.chunks[ix];
+			if (!overlaps_time(curr, from, to) || curr.value_max() < lo || hi < curr.value_min())
+				continue;
+
+			if (covers_time(curr, from, to) && !(curr.value_min() < lo) && !(hi < curr.value_max()))
+			{
+				total += curr.size();
+				continue;
+			}
+
+			auto range = scan_range(curr, from, to);
+			auto times = curr.timestamps().data();
+			auto values = curr.values().data();
+			size_type count = 0;
+			for (auto row = range.first; row != range.second; ++row)
+			{
+				count += size_type((!(times[row] < from)) & (times[row] < to) &
+					(!(values[row] < lo)) & (!(hi < values[row])));
+			}
+			total += count;
+		}
+		return total;
+	}
+
+	///Calls `func(timestamp, value)` for each row with a timestamp in `[from, to)`,
+	///chunk by chunk in the order they were sealed.
+	template<typename Func>
+	void for_each(Timestamp from, Timestamp to, Func &&func) const
+	{
+		auto view = snapshot();
+		for (size_type ix = 0; ix != view.count; ++ix)
+		{
+			auto &curr = *view.chunks[ix];
+			if (!overlaps_time(curr, from, to))
+				continue;
+
+			auto range = scan_range(curr, from, to);
+			auto times = curr.timestamps().data();
+			auto values = curr.values().data();
+			for (auto row = range.first; row != range.second; ++row)
+			{
+				if (!(times[row] < from) && times[row] < to)
+					func(times[row], values[row]);
+			}
+		}
+	}
+
+	///Calls `func(timestamp, value)` for each row with a timestamp in `[from, to)` and a value in `[lo, hi]`.
+	template<typename Func>
+	void for_each_where(Timestamp from, Timestamp to, Value lo, Value hi, Func &&func) const
+	{
+		auto view = snapshot();
+		for (size_type ix = 0; ix != view.count; ++ix)
+		{
+			auto &curr = *view.chunks[ix];
+			if (!overlaps_time(curr, from, to) || curr.value_max() < lo || hi < curr.value_min())
+				continue;
+
+			auto range = scan_range(curr, from, to);
+			auto times = curr.timestamps().data();
+			auto values = curr.values().data();
+			for (auto row = range.first; row != range.second; ++row)
+			{
+				if (!(times[row] < from) && times[row] < to && !(values[row] < lo) && !(hi < values[row]))
+					func(times[row], values[row]);
+			}
+		}
+	}
+
+private:
+	using directory = my_vector<const chunk_type*>;
+
+	//The chunks a query may look at: a prefix of the directory.
+	struct chunk_view
+	{
+		const chunk_type *const *chunks;
+		size_type count;
+	};
+
+	size_type chunk_rows_;
+	//Writer only.
+	std::unique_ptr<chunk_type> open_;
+	my_vector<std::unique_ptr<chunk_type>> chunks_;
+	//Every directory ever published, oldest first. Readers may still be using an old one,
+	//so they are kept until the store is destroyed; each is twice the size of the last.
+	my_vector<std::unique_ptr<directory>> directories_;
+	//The newest directory, and how many of its entries are sealed chunks.
+	//A directory only has entries appended within its capacity, so readers see it grow but never move.
+	std::atomic<const directory*> directory_;
+	std::atomic<size_type> sealed_{ 0 };
+
+	//Loads the count before the directory: a directory at least as new as the count has that many entries.
+	chunk_view snapshot() const noexcept
+	{
+		auto count = sealed_.load(std::memory_order_acquire);
+		auto dir = directory_.load(std::memory_order_acquire);
+		return { dir->data(), count };
+	}
+
+	void seal()
+	{
+		auto dir = directories_.back().get();
+		//Room for the new entries is made first, so nothing can throw once a directory is published.
+		if (chunks_.size() == chunks_.capacity())
+			chunks_.reserve(chunks_.capacity() * 2 + 8);
+		if (dir->size() == dir->capacity())
+		{
+			auto bigger = std::make_unique<directory>();
+			bigger->reserve(dir->capacity() * 2);
+			bigger->insert(bigger->end(), dir->begin(), dir->end());
+			if (directories_.size() == directories_.capacity())
+				directories_.reserve(directories_.capacity() * 2 + 8);
+
+			bigger->push_back(open_.get());
+			directory_.store(bigger.get(), std::memory_order_release);
+			directories_.push_back(std::move(bigger));
+		}
+		else
+		{
+			dir->push_back(open_.get());
+		}
+
+		chunks_.push_back(std::move(open_));
+		sealed_.store(chunks_.size(), std::memory_order_release);
+	}
+
+	static bool overlaps_time(const chunk_type &curr, Timestamp from, Timestamp to) noexcept
+	{
+		return !(curr.time_max() < from) && curr.time_min() < to;
+	}
+
+	static bool covers_time(const chunk_type &curr, Timestamp from, Timestamp to) noexcept
+	{
+		return !(curr.time_min() < from) && curr.time_max() < to;
+	}
+
+	//The rows of `curr` that may have timestamps in `[from, to)`: found by binary search
+	//if the chunk is in time order, or else all of them.
+	static std::pair<size_type, size_type> scan_range(const chunk_type &curr, Timestamp from, Timestamp to)
+	{
+		if (!curr.time_ordered())
+			return { 0, curr.size() };
+
+		auto &times = curr.timestamps();
+		auto first = std::lower_bound(times.begin(), times.end(), from);
+		auto last = std::lower_bound(first, times.end(), to);
+		return { size_type(first - times.begin()), size_type(last - times.begin()) };
+	}
+
+	//Summarizes the rows of a chunk that straddles a time bound.
+	//Rows outside the bounds are masked out rather than branched around.
+	static summary_type scan_summary(const chunk_type &curr, Timestamp from, Timestamp to)
+	{
+		auto range = scan_range(curr, from, to);
+		auto times = curr.timestamps().data();
+		auto values = curr.values().data();
+
+		summary_type out;
+		out.min = curr.value_max();
+		out.max = curr.value_min();
+		for (auto row = range.first; row != range.second; ++row)
+		{
+			auto in = (!(times[row] < from)) & (times[row] < to);
+			auto value = values[row];
+			out.count += size_type(in);
+			out.sum += in ? value : Value();
+			out.min = std::min(out.min, in ? value : out.min);
+			out.max = std::max(out.max, in ? value : out.max);
+		}
+		return out;
+	}
+};
+
+#endif //TIMESERIES_STORE_HEADER
@@ -0,0 +1,406 @@
+#ifndef VECTOR_EXPR_HEADER
+#define VECTOR_EXPR_HEADER
+
+#include "my_vector.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+///Expression templates for element-wise arithmetic over `my_vector`s and spans of them.
+///`out = a * b + c` builds a small expression object instead of temporary vectors,
+///and assigning it to `out` evaluates the whole chain in one loop, writing each result
+///straight into `out`'s storage.
+///Expressions refer to the vectors in them, rather than copying them, so they must be
+///evaluated before those vectors change or are destroyed.
+namespace vector_expr
+{
+	///Base of every expression node.
+	template<typename Derived>
+	struct expression
+	{
+		using is_vector_expression = void;
+
+		const Derived &derived() const noexcept { return static_cast<const Derived&>(*this); }
+
+		///Evaluates the expression into `out`; used by `my_vector`'s constructor and assignment.
+		template<typename Vec>
+		void assign_to(Vec &out) const;
+	};
+
+	///A contiguous run of elements: all of a `my_vector`, or a span of one.
+	template<typename T>
+	struct view : expression<view<T>>
+	{
+		using value_type = T;
+
+		view(const T *first, std::size_t size) noexcept : first_(first), size_(size) {}
+
+		std::size_t size() const noexcept { return size_; }
+		const T &operator[](std::size_t ix) const noexcept { return first_[ix]; }
+
+	private:
+		const T *first_;
+		std::size_t size_;
+	};
+
+	///A value broadcast to every element. Scalars have no size of their own,
+	///so they can only appear alongside a vector.
+	template<typename T>
+	struct scalar
+	{
+		using value_type = T;
+
+		explicit scalar(const T &value) : value_(value) {}
+
+		const T &operator[](std::size_t) const noexcept { return value_; }
+
+	private:
+		T value_;
+	};
+
+	namespace detail
+	{
+		//How a value is held when used as an operand.
+		//`sized` is false for scalars, which take their size from the other operand.
+		template<typename X, typename = void>
+		struct operand {};
+
+		template<typename T, typename Alloc>
+		struct operand<my_vector<T, Alloc>, void>
+		{
+			static constexpr bool sized = true;
+			using type = view<T>;
+
+			static type make(const my_vector<T, Alloc> &vec) noexcept { return type(vec.data(), vec.size()); }
+			static std::size_t size(const my_vector<T, Alloc> &vec) noexcept { return vec.size(); }
+		};
+
+		template<typename X>
+		struct operand<X, vector_tools::detail::void_t<typename X::is_vector_expression>>
+		{
+			static constexpr bool sized = true;
+			using type = X;
+
+			static const X &make(const X &expr) noexcept { return expr; }
+			static std::size_t size(const X &expr) noexcept { return expr.size(); }
+		};
+
+		template<typename X>
+		struct operand<X, std::enable_if_t<std::is_arithmetic<X>::value>>
+		{
+			static constexpr bool sized = false;
+			using type = scalar<X>;
+
+			static type make(const X &value) { return type(value); }
+			static std::size_t size(const X &) noexcept { return 0; }
+		};
+
+		template<typename X>
+		using operand_t = typename operand<X>::type;
+
+		template<typename X, typename = void>
+		struct is_sized : std::false_type {};
+
+		template<typename X>
+		struct is_sized<X, vector_tools::detail::void_t<operand_t<X>>>
+			: std::integral_constant<bool, operand<X>::sized> {};
+
+		//Operators apply when both sides are operands, and at least one of them has a size.
+		template<typename L, typename R, typename = void>
+		struct is_binary : std::false_type {};
+
+		template<typename L, typename R>
+		struct is_binary<L, R, vector_tools::detail::void_t<operand_t<L>, operand_t<R>>>
+			: std::integral_constant<bool, operand<L>::sized || operand<R>::sized> {};
+
+		template<typename L, typename R>
+		std::size_t common_size(const L &left, const R &right)
+		{
+			if (operand<L>::sized && operand<R>::sized && operand<L>::size(left) != operand<R>::size(right))
+				throw std::invalid_argument("vector_expr: operand sizes differ");
+
+			return operand<L>::sized ? operand<L>::size(left) : operand<R>::size(right);
+		}
+	}
+
+	template<typename Op, typename E>
+	struct unary : expression<unary<Op, E>>
+	{
+		using value_type = std::decay_t<decltype(std::declval<const Op&>()(std::declval<typename E::value_type>()))>;
+
+		unary(const E &expr, const Op &op) : expr_(expr), op_(op) {}
+
+		std::size_t size() const noexcept { return expr_.size(); }
+		value_type operator[](std::size_t ix) const { return op_(expr_[ix]); }
+
+	private:
+		E expr_;
+		Op op_;
+	};
+
+	template<typename Op, typename L, typename R>
+	struct binary : expression<binary<Op, L, R>>
+	{
+		using value_type = std::decay_t<decltype(std::declval<const Op&>()(
+			std::declval<typename L::value_type>(), std::declval<typename R::value_type>()))>;
+
+		binary(const L &left, const R &right, const Op &op, std::size_t size)
+			: left_(left), right_(right), op_(op), size_(size) {}
+
+		std::size_t size() const noexcept { return size_; }
+		value_type operator[](std::size_t ix) const { return op_(left_[ix], right_[ix]); }
+
+	private:
+		L left_;
+		R right_;
+		Op op_;
+		std::size_t size_;
+	};
+
+	///Combines `left` and `right` element by element with `op`.
+	///Either side may be a vector, an expression or an arithmetic scalar, but not both scalars.
+	///Throws `std::invalid_argument` if the two sides have different sizes.
+	template<typename Op, typename L, typename R, typename = std::enable_if_t<detail::is_binary<L, R>::value>>
+	binary<Op, detail::operand_t<L>, detail::operand_t<R>> zip(const L &left, const R &right, const Op &op)
+	{
+		return binary<Op, detail::operand_t<L>, detail::operand_t<R>>(detail::operand<L>::make(left),
+			detail::operand<R>::make(right), op, detail::common_size(left, right));
+	}
+
+	///Applies `op` to each element of a vector or expression.
+	template<typename X, typename Op, typename = std::enable_if_t<detail::is_sized<X>::value>>
+	unary<Op, detail::operand_t<X>> map(const X &expr, const Op &op)
+	{
+		return unary<Op, detail::operand_t<X>>(detail::operand<X>::make(expr), op);
+	}
+
+	///The `count` elements of `vec` starting at `pos`. `count` is clamped to the end of the vector.
+	///Throws `std::out_of_range` if `pos` is past the end.
+	template<typename T, typename Alloc>
+	view<T> span(const my_vector<T, Alloc> &vec, std::size_t pos, std::size_t count)
+	{
+		if (pos > vec.size())
+			throw std::out_of_range("Out of range");
+
+		return view<T>(vec.data() + pos, std::min(count, vec.size() - pos));
+	}
+
+	template<typename T>
+	view<T> span(const T *first, std::size_t count) noexcept
+	{
+		return view<T>(first, count);
+	}
+
+	template<typename L, typename R, typename = std::enable_if_t<detail::is_binary<L, R>::value>>
+	auto operator+(const L &left, const R &right) { return zip(left, right, std::plus<>()); }
+
+	template<typename L, typename R, typename = std::enable_if_t<detail::is_binary<L, R>::value>>
+	auto operator-(const L &left, const R &right) { return zip(left, right, std::minus<>()); }
+
+	template<typename L, typename R, typename = std::enable_if_t<detail::is_binary<L, R>::value>>
+	auto operator*(const L &left, const R &right) { return zip(left, right, std::multiplies<>()); }
+
+	template<typename L, typename R, typename = std::enable_if_t<detail::is_binary<L, R>::value>>
+	auto operator/(const L &left, const R &right) { return zip(left, right, std::divides<>()); }
+
+	template<typename X, typename = std::enable_if_t<detail::is_sized<X>::value>>
+	auto operator-(const X &expr) { return map(expr, std::negate<>()); }
+
+	///Evaluations are not split into chunks smaller than this many elements,
+	///as starting a thread costs more than working through them.
+	constexpr std::size_t parallel_grain = std::size_t(1) << 15;
+
+	namespace detail
+	{
+		template<typename T, typename E>
+		void evaluate_range(T *out, const E &expr, std::size_t first, std::size_t last)
+		{
+			//A local copy lets the compiler keep the operand pointers in registers,
+			//since stores to `out` cannot change them.
+			const E local = expr;
+			for (auto ix = first; ix != last; ++ix)
+				out[ix] = local[ix];
+		}
+
+		template<typename R, typename E, typename Op>
+		R reduce_range(R acc, const E &expr, std::size_t first, std::size_t last, Op &op)
+		{
+			const E local = expr;
+			for (auto ix = first; ix != last; ++ix)
+				acc = op(std::move(acc), local[ix]);
+			return acc;
+		}
+
+		//How `size` elements are split for up to `thread_count` threads;
+		//a `thread_count` of 0 means one per hardware thread.
+		//Chunk boundaries fall on multiples of 64 elements, so chunks never share a cache line of output,
+		//and every chunk but the last holds exactly `per_chunk` elements.
+		struct chunking
+		{
+			chunking(std::size_t size, unsigned thread_count)
+				: size(size)
+			{
+				if (thread_count == 0)
+					thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+				count = std::max<std::size_t>(1, std::min<std::size_t>(thread_count, size / parallel_grain));
+				per_chunk = (size / count + 63) & ~std::size_t(63);
+				if (count > 1)
+					count = (size + per_chunk - 1) / per_chunk;
+			}
+
+			std::size_t size;
+			std::size_t count;
+			std::size_t per_chunk;
+		};
+
+		//Calls `func(chunk, first, last)` for each chunk, each on its own thread
+		//except the first, which runs on the calling thread.
+		//Rethrows the first exception thrown by any chunk, once all of them have finished.
+		template<typename Func>
+		void for_each_chunk(const chunking &chunks, const Func &func)
+		{
+			auto count = chunks.count;
+			auto run = [&](std::size_t chunk) {
+				auto first = chunk * chunks.per_chunk;
+				auto last = chunk + 1 == count ? chunks.size : first + chunks.per_chunk;
+				func(chunk, first, last);
+			};
+
+			if (count == 1)
+			{
+				run(0);
+				return;
+			}
+
+			my_vector<std::exception_ptr> errors(count);
+			my_vector<std::thread> workers;
+			workers.reserve(count - 1);
+
+			auto join_all = [&] {
+				for (auto &worker : workers)
+					worker.join();
+			};
+
+			try
+			{
+				for (std::size_t chunk = 1; chunk < count; ++chunk)
+				{
+					workers.emplace_back([&, chunk] {
+						try { run(chunk); }
+						catch (...) { errors[chunk] = std::current_exception(); }
+					});
+				}
+
+				run(0);
+			}
+			catch (...)
+			{
+				join_all();
+				throw;
+			}
+
+			join_all();
+			for (auto &error : errors)
+			{
+				if (error)
+					std::rethrow_exception(error);
+			}
+		}
+	}
+
+	///Evaluates `expr` into `out`, resizing it to match and reusing its capacity.
+	///New elements of trivial type are not initialized before being overwritten.
+	///`out` may itself appear in the expression, as long as it is used whole rather than through a span.
+	template<typename T, typename Alloc, typename X, typename = std::enable_if_t<detail::is_sized<X>::value>>
+	void assign(my_vector<T, Alloc> &out, const X &expr)
+	{
+		auto &&node = detail::operand<X>::make(expr);
+		auto size = node.size();
+		out.resize_default_init(size);
+		detail::evaluate_range(out.data(), node, 0, size);
+	}
+
+	///As `assign`, but large expressions are evaluated in chunks on up to `thread_count` threads.
+	///A `thread_count` of 0 uses one thread per hardware thread.
+	template<typename T, typename Alloc, typename X, typename = std::enable_if_t<detail::is_sized<X>::value>>
+	void assign_parallel(my_vector<T, Alloc> &out, const X &expr, unsigned thread_count = 0)
+	{
+		auto &&node = detail::operand<X>::make(expr);
+		auto size = node.size();
+		out.resize_default_init(size);
+
+		auto dest = out.data();
+		detail::for_each_chunk(detail::chunking(size, thread_count),
+			[&](std::size_t, std::size_t first, std::size_t last) {
+				detail::evaluate_range(dest, node, first, last);
+			});
+	}
+
+	///Folds the elements of a vector or expression into `init` with `op`, in order.
+	template<typename X, typename R, typename Op, typename = std::enable_if_t<detail::is_sized<X>::value>>
+	R reduce(const X &expr, R init, Op op)
+	{
+		auto &&node = detail::operand<X>::make(expr);
+		return detail::reduce_range(std::move(init), node, 0, node.size(), op);
+	}
+
+	///As `reduce`, but large expressions are split into chunks reduced on up to `thread_count` threads,
+	///and the chunks' results then folded into `init` in order.
+	///`op` must be associative, and is called concurrently.
+	template<typename X, typename R, typename Op, typename = std::enable_if_t<detail::is_sized<X>::value>>
+	R reduce_parallel(const X &expr, R init, Op op, unsigned thread_count = 0)
+	{
+		auto &&node = detail::operand<X>::make(expr);
+		auto size = node.size();
+		detail::chunking chunks(size, thread_count);
+		if (chunks.count == 1)
+			return detail::reduce_range(std::move(init), node, 0, size, op);
+
+		//Each chunk is seeded with its own first element, so `init` is only used once.
+		my_vector<R> partials(chunks.count, init);
+		detail::for_each_chunk(chunks, [&](std::size_t chunk, std::size_t first, std::size_t last) {
+			partials[chunk] = detail::reduce_range(R(node[first]), node, first + 1, last, op);
+		});
+
+		for (auto &partial : partials)
+			init = op(std::move(init), std::move(partial));
+		return init;
+	}
+
+	///The sum of the elements of a vector or expression.
+	template<typename X, typename = std::enable_if_t<detail::is_sized<X>::value>>
+	auto sum(const X &expr)
+	{
+		using value_type = typename detail::operand_t<X>::value_type;
+		return reduce(expr, value_type(), std::plus<>());
+	}
+
+	///The sum of the products of corresponding elements. Throws `std::invalid_argument` if the sizes differ.
+	template<typename L, typename R, typename = std::enable_if_t<detail::is_sized<L>::value && detail::is_sized<R>::value>>
+	auto dot(const L &left, const R &right)
+	{
+		return sum(zip(left, right, std::multiplies<>()));
+	}
+
+	template<typename Derived>
+	template<typename Vec>
+	void expression<Derived>::assign_to(Vec &out) const
+	{
+		vector_expr::assign(out, derived());
+	}
+}
+
+//`my_vector` lives in the global namespace, so that is where lookup finds operators on it.
+//These name the same templates, so expressions that find both remain unambiguous.
+using vector_expr::operator+;
+using vector_expr::operator-;
+using vector_expr::operator*;
+using vector_expr::operator/;
+
+#endif //VECTOR_EXPR_HEADER
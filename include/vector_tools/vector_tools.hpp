@@ -1,10 +1,23 @@
 #ifndef VECTOR_TOOLS_HEADER
 #define VECTOR_TOOLS_HEADER
 
+#include <algorithm>
 #include <cstddef>
+#include <cstring>
 #include <memory>
 #include <type_traits>
 
+//C++20 allows allocation, construction and destruction during constant evaluation.
+//Where the compiler and library support it, the primitives and `my_vector` are `constexpr`,
+//so tables can be built with them at compile time.
+#if defined(__cpp_constexpr_dynamic_alloc) && defined(__cpp_lib_constexpr_dynamic_alloc)
+#define VECTOR_TOOLS_HAS_CONSTEXPR_ALLOC 1
+#define VECTOR_TOOLS_CONSTEXPR constexpr
+#else
+#define VECTOR_TOOLS_HAS_CONSTEXPR_ALLOC 0
+#define VECTOR_TOOLS_CONSTEXPR
+#endif
+
 namespace vector_tools
 {
 	namespace detail
@@ -12,6 +25,17 @@ namespace vector_tools
 		template< class... >
 		using void_t = void;
 
+		///True during constant evaluation, where `memcpy`-style fast paths are not allowed.
+		///Always false before C++20.
+		constexpr bool is_constant_evaluated() noexcept
+		{
+#if defined(__cpp_lib_is_constant_evaluated)
+			return std::is_constant_evaluated();
+#else
+			return false;
+#endif
+		}
+
 		template<typename Alloc, typename = void_t<> >
 		struct uses_default_destroy : std::false_type
 		{};
@@ -20,6 +44,25 @@ namespace vector_tools
 		struct uses_default_destroy<Alloc,
 			void_t<decltype(std::declval<Alloc>()->destroy(std::declval<typename Alloc::value_type*>()))>> : std::true_type
 		{};
+
+		///True if `Alloc` wants to hear how full a vector's storage is after each append,
+		///through `alloc.growth_hint(size, capacity, next_capacity)`.
+		template<typename Alloc, typename = void_t<> >
+		struct has_growth_hint : std::false_type
+		{};
+
+		template<typename Alloc >
+		struct has_growth_hint<Alloc,
+			void_t<decltype(std::declval<Alloc&>().growth_hint(std::size_t(), std::size_t(), std::size_t()))>> : std::true_type
+		{};
+
+		///True if relocating `T`s through `Alloc` may be done with `memmove`.
+		///That requires a trivially copyable `T` and an allocator whose `construct`/`destroy`
+		///do nothing beyond placement new and the destructor.
+		template<typename T, typename Alloc>
+		struct uses_trivial_relocation : std::integral_constant<bool,
+			std::is_trivially_copyable<T>::value && std::is_same<Alloc, std::allocator<T>>::value>
+		{};
 	}
 
 	///Destroys all elements in the given range, in reverse order, by calling the destructor.
@@ -27,7 +70,7 @@ namespace vector_tools
 	///We could add a SFINAE overload for trivially destructible types that does nothing.
 	///But I trust the compiler to do its job.
 	template<typename T>
-	void destructor_destroy_range(T *begin, T *end) noexcept
+	VECTOR_TOOLS_CONSTEXPR void destructor_destroy_range(T *begin, T *end) noexcept
 	{
 		while (end != begin)
 		{
@@ -40,7 +83,7 @@ namespace vector_tools
 	///Only allowed if `Alloc::destroy` doesn't exist.
 	///Empty ranges are fine, as are NULL ranges.
 	template<typename T, typename Alloc>
-	std::enable_if_t<detail::uses_default_destroy<Alloc>::value> destroy_range(T *begin, T *end, Alloc &) noexcept
+	VECTOR_TOOLS_CONSTEXPR std::enable_if_t<detail::uses_default_destroy<Alloc>::value> destroy_range(T *begin, T *end, Alloc &) noexcept
 	{
 		destructor_destroy_range(begin, end);
 	}
@@ -48,7 +91,7 @@ namespace vector_tools
 	///Destroys all elements in the given range, in reverse order, using the allocator's destroy call.
 	///Empty ranges are fine, as are NULL ranges.
 	template<typename T, typename Alloc>
-	std::enable_if_t<!detail::uses_default_destroy<Alloc>::value> destroy_range(T *begin, T *end, Alloc &alloc) noexcept
+	VECTOR_TOOLS_CONSTEXPR std::enable_if_t<!detail::uses_default_destroy<Alloc>::value> destroy_range(T *begin, T *end, Alloc &alloc) noexcept
 	{
 		while (end != begin)
 		{
@@ -87,7 +130,7 @@ namespace vector_tools
 	///If any element fails to be constructed, it will destroy all previously constructed elements.
 	///Destruction happens initialization using `destroy_range`.
 	template<typename T, typename Alloc, typename ...Args>
-	T *emplace_construct_count(T *first, std::size_t count, Alloc &alloc, Args &&...args)
+	VECTOR_TOOLS_CONSTEXPR T *emplace_construct_count(T *first, std::size_t count, Alloc &alloc, Args &&...args)
 	{
 		auto curr = first;
 		try
@@ -104,14 +147,32 @@ namespace vector_tools
 		return curr;
 	}
 
+	///Initializes `count` elements in an array, starting at `first`, for the caller to overwrite.
+	///Where `T` is trivially default constructible and `Alloc` is `std::allocator`,
+	///the elements are default-initialized, which writes nothing; otherwise this is
+	///`emplace_construct_count` with no arguments.
+	///Returns a pointer to the one-past-the-end element of the array.
+	template<typename T, typename Alloc>
+	VECTOR_TOOLS_CONSTEXPR T *default_construct_count(T *first, std::size_t count, Alloc &alloc)
+	{
+		if (std::is_trivially_default_constructible<T>::value &&
+			std::is_same<Alloc, std::allocator<T>>::value && !detail::is_constant_evaluated())
+		{
+			return first + count;
+		}
+
+		return emplace_construct_count(first, count, alloc);
+	}
+
 	///Initializes the elements in `output`,
 	///by copy-constructing from the `input/end` range.
+	///`input/end` may be any input iterator range whose elements `T` can be constructed from.
 	///The copy will be performed by using `allocator_traits<Alloc>::construct`.
 	///Returns a pointer to the one-past-the-end element of the new array.
 	///If a copy throws, it will destroy all previously constructed elements.
 	///Destruction happens initialization using `destroy_range`.
-	template<typename T, typename Alloc>
-	T *copy_insert_range(T *output, Alloc &alloc, const T *input, const T *end)
+	template<typename T, typename Alloc, typename InputIt>
+	VECTOR_TOOLS_CONSTEXPR T *copy_insert_range(T *output, Alloc &alloc, InputIt input, InputIt end)
 	{
 		auto curr = output;
 		try
@@ -137,7 +198,7 @@ namespace vector_tools
 	///Destruction happens initialization using `destroy_range`.
 	///But if it was a move that caused this... good luck on getting your data back ;)
 	template<typename T, typename Alloc>
-	T *safemove_insert_range(T *output, Alloc &alloc, T *input, T *end)
+	VECTOR_TOOLS_CONSTEXPR T *safemove_insert_range(T *output, Alloc &alloc, T *input, T *end)
 	{
 		auto curr = output;
 		try
@@ -163,7 +224,7 @@ namespace vector_tools
 	///as we may have overwritten data.
 	///Returns `target + (end - input)`.
 	template<typename T>
-	T *safemove_assign_shift_left(T *target, T *input, T *end)
+	VECTOR_TOOLS_CONSTEXPR T *safemove_assign_shift_left(T *target, T *input, T *end)
 	{
 		if (target == input)
 			return target;
@@ -174,6 +235,120 @@ namespace vector_tools
 		return target;
 	}
 
+	namespace detail
+	{
+		template<typename T, typename Alloc>
+		VECTOR_TOOLS_CONSTEXPR T *relocate_range(T *output, Alloc &alloc, T *input, T *end, std::false_type)
+		{
+			auto curr = output;
+			try
+			{
+				for (; input != end; ++curr, ++input)
+				{
+					std::allocator_traits<Alloc>::construct(alloc, curr, std::move_if_noexcept(*input));
+					std::allocator_traits<Alloc>::destroy(alloc, input);
+				}
+			}
+			catch (...)
+			{
+				//curr was never constructed, and input was never destroyed.
+				destroy_range(output, curr, alloc);
+				destroy_range(input, end, alloc);
+				throw;
+			}
+			return curr;
+		}
+
+		template<typename T, typename Alloc>
+		VECTOR_TOOLS_CONSTEXPR T *relocate_range(T *output, Alloc &alloc, T *input, T *end, std::true_type) noexcept
+		{
+			if (is_constant_evaluated())
+				return relocate_range(output, alloc, input, end, std::false_type{});
+
+			auto count = std::size_t(end - input);
+			if (count != 0)
+				std::memmove(output, input, count * sizeof(T));
+			return output + count;
+		}
+	}
+
+	///Relocates the elements of the `input/end` range into the unconstructed storage
+	///beginning at `output`. Each element is safe-moved through `alloc`, then its source is destroyed.
+	///Afterwards, `input/end` is unconstructed storage.
+	///The two ranges may overlap, so long as `output` is not after `input`.
+	///Trivially copyable types using `std::allocator` are relocated with a single `memmove`.
+	///Returns a pointer to the one-past-the-end element of the new array.
+	///If a move throws, all elements in both ranges are destroyed, leaving them unconstructed.
+	template<typename T, typename Alloc>
+	VECTOR_TOOLS_CONSTEXPR T *relocate_range(T *output, Alloc &alloc, T *input, T *end)
+	{
+		return detail::relocate_range(output, alloc, input, end,
+			detail::uses_trivial_relocation<T, Alloc>{});
+	}
+
+	namespace detail
+	{
+		//Rotating through a buffer this size costs no more than a few cache lines of stack.
+		constexpr std::size_t rotate_buffer_bytes = 512;
+
+		//Trivially copyable types: if the shorter side fits in a stack buffer,
+		//set it aside, `memmove` the longer side over, and copy the shorter side back.
+		template<typename T>
+		VECTOR_TOOLS_CONSTEXPR T *rotate_range(T *first, T *middle, T *last, std::true_type)
+		{
+			auto left = std::size_t(middle - first);
+			auto right = std::size_t(last - middle);
+			if (is_constant_evaluated() || std::min(left, right) * sizeof(T) > rotate_buffer_bytes)
+				return std::rotate(first, middle, last);
+
+			alignas(T) unsigned char buffer[rotate_buffer_bytes];
+			if (left <= right)
+			{
+				std::memcpy(buffer, first, left * sizeof(T));
+				std::memmove(first, middle, right * sizeof(T));
+				std::memcpy(first + right, buffer, left * sizeof(T));
+			}
+			else
+			{
+				std::memcpy(buffer, middle, right * sizeof(T));
+				std::memmove(first + right, first, left * sizeof(T));
+				std::memcpy(first, buffer, right * sizeof(T));
+			}
+
+			return first + right;
+		}
+
+		template<typename T>
+		VECTOR_TOOLS_CONSTEXPR T *rotate_range(T *first, T *middle, T *last, std::false_type)
+		{
+			return std::rotate(first, middle, last);
+		}
+	}
+
+	///Moves the block of constructed elements `first/last` so that it lands at `dest`,
+	///shifting the elements in between to fill the gap. Nothing is allocated.
+	///If `dest` is before `first`, the block will begin at `dest`.
+	///If `dest` is after `last`, the block will end at `dest`.
+	///If `dest` is within `first/last`, nothing moves.
+	///Trivially copyable types are moved with `memcpy`/`memmove` where a small stack buffer suffices;
+	///other types are rotated in place by swapping.
+	///If a swap throws, the elements are left in a valid but unspecified order.
+	///Returns a pointer to the new position of the element originally at `first`.
+	template<typename T>
+	VECTOR_TOOLS_CONSTEXPR T *slide(T *first, T *last, T *dest)
+	{
+		if (dest < first)
+		{
+			detail::rotate_range(dest, first, last, std::is_trivially_copyable<T>{});
+			return dest;
+		}
+
+		if (last < dest)
+			return detail::rotate_range(first, last, dest, std::is_trivially_copyable<T>{});
+
+		return first;
+	}
+
 	///A partition represents a set of ranges of elements. The first range has been
 	///moved from, and the second range are unconstructed memory.
 	template<typename T>
@@ -197,10 +372,12 @@ namespace vector_tools
 	///On exceptions, only previously unconstructed elements are deleted.
 	///Returns the range of the partitioned elements.
 	template<typename T, typename Alloc>
-	partition<T> safemove_partition_right(T *pos, T *last, Alloc &alloc, T *back)
+	VECTOR_TOOLS_CONSTEXPR partition<T> safemove_partition_right(T *pos, T *last, Alloc &alloc, T *back)
 	{
-		auto src = last - 1;
-		auto new_dst = back - 1;
+		auto src = last;
+		auto new_dst = back;
+		//The start of the elements constructed so far in `last/back`.
+		auto constructed = back;
 		try
 		{
 			//Move-insert in reverse order, until either we run out of elements to move
@@ -209,6 +386,7 @@ namespace vector_tools
 			{
 				--src; --new_dst;
 				std::allocator_traits<Alloc>::construct(alloc, new_dst, std::move_if_noexcept(*src));
+				constructed = new_dst;
 			}
 
 			//Move-assign in reverse order until we run out of elements to move.
@@ -225,9 +403,7 @@ namespace vector_tools
 		}
 		catch (...)
 		{
-			//new_dst itself was never successfully constructed.
-			++new_dst;
-			destroy_range(new_dst, back, alloc);
+			destroy_range(constructed, back, alloc);
 			throw;
 		}
 	}
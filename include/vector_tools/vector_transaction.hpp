@@ -0,0 +1,294 @@
+#ifndef VECTOR_TRANSACTION_HEADER
+#define VECTOR_TRANSACTION_HEADER
+
+#include "my_vector.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace detail
+{
+	enum class undo_kind : unsigned char
+	{
+		inserted,	//`count` elements were inserted at `pos`; undone by erasing them.
+		erased,		//`count` elements were erased from `pos`; they are saved, and undone by inserting them again.
+		assigned,	//`count` elements from `pos` were overwritten; the old values are saved, and assigned back.
+	};
+
+	struct undo_record
+	{
+		undo_kind kind;
+		std::size_t pos;
+		std::size_t count;
+	};
+}
+
+///Makes a series of edits to a `my_vector` undoable. Every edit made through the transaction
+///goes to the vector's own insert, erase or element assignment, and first logs its inverse:
+///the position and count of inserted elements, and the values of erased and overwritten ones.
+///The cost of logging, and of rolling back, is proportional to the edit rather than the vector.
+///
+///`rollback` undoes the logged edits in reverse order; `commit` keeps them and clears the log.
+///Edits made after either form a new transaction. The destructor rolls back whatever has not been committed.
+///
+///While the transaction is open, all changes to the vector must go through it.
+///Elements are saved by move if `T`'s moves cannot throw, and copied otherwise.
+template<typename T, typename Alloc = std::allocator<T>>
+class vector_transaction
+{
+public:
+	using vector_type = my_vector<T, Alloc>;
+	using size_type = typename vector_type::size_type;
+	using iterator = typename vector_type::iterator;
+	using const_iterator = typename vector_type::const_iterator;
+
+	explicit vector_transaction(vector_type &vec) noexcept : vec_(vec) {}
+
+	vector_transaction(const vector_transaction &) = delete;
+	vector_transaction &operator=(const vector_transaction &) = delete;
+
+	~vector_transaction()
+	{
+		rollback();
+	}
+
+	const vector_type &vector() const noexcept { return vec_; }
+
+	///True if there are edits that `rollback` would undo.
+	bool pending() const noexcept { return !records_.empty(); }
+
+	///The number of elements the log holds to restore erased and overwritten values.
+	size_type saved_size() const noexcept { return saved_.size(); }
+
+	void commit() noexcept
+	{
+		records_.clear();
+		saved_.clear();
+	}
+
+	void rollback()
+	{
+		while (!records_.empty())
+		{
+			auto record = records_.back();
+			auto pos = vec_.begin() + record.pos;
+			switch (record.kind)
+			{
+			case detail::undo_kind::inserted:
+				vec_.erase(pos, pos + record.count);
+				break;
+			case detail::undo_kind::erased:
+				//The vector's capacity has not shrunk since the erase, so this does not allocate.
+				vec_.insert(pos, restore_iterator(saved_.end() - record.count), restore_iterator(saved_.end()));
+				saved_.erase(saved_.end() - record.count, saved_.end());
+				break;
+			case detail::undo_kind::assigned:
+				std::move(saved_.end() - record.count, saved_.end(), pos);
+				saved_.erase(saved_.end() - record.count, saved_.end());
+				break;
+			}
+			records_.pop_back();
+		}
+		saved_.clear();
+	}
+
+	iterator insert(const_iterator pos, const T &value)
+	{
+		return logged_insert(pos, 1, [&] { return vec_.insert(pos, value); });
+	}
+
+	iterator insert(const_iterator pos, T &&value)
+	{
+		return logged_insert(pos, 1, [&] { return vec_.insert(pos, std::move(value)); });
+	}
+
+	iterator insert(const_iterator pos, size_type count, const T &value)
+	{
+		return logged_insert(pos, count, [&] { return vec_.insert(pos, count, value); });
+	}
+
+	template<typename ForwardIt, typename = std::enable_if_t<std::is_base_of<std::forward_iterator_tag,
+		typename std::iterator_traits<ForwardIt>::iterator_category>::value>>
+	iterator insert(const_iterator pos, ForwardIt first, ForwardIt last)
+	{
+		auto count = size_type(std::distance(first, last));
+		return logged_insert(pos, count, [&] { return vec_.insert(pos, first, last); });
+	}
+
+	void push_back(const T &value)
+	{
+		logged_insert(vec_.end(), 1, [&] { vec_.push_back(value); return vec_.end() - 1; });
+	}
+
+	void push_back(T &&value)
+	{
+		logged_insert(vec_.end(), 1, [&] { vec_.push_back(std::move(value)); return vec_.end() - 1; });
+	}
+
+	template<typename ...Args>
+	T &emplace_back(Args &&...args)
+	{
+		return *logged_insert(vec_.end(), 1, [&] { vec_.emplace_back(std::forward<Args>(args)...); return vec_.end() - 1; });
+	}
+
+	iterator erase(const_iterator pos)
+	{
+		return erase(pos, pos + 1);
+	}
+
+	iterator erase(const_iterator beg, const_iterator last)
+	{
+		auto count = size_type(last - beg);
+		if (count == 0)
+			return const_cast<iterator>(beg);
+
+		auto ix = size_type(beg - vec_.cbegin());
+		reserve_record();
+		save(beg, last);
+		records_.push_back({ detail::undo_kind::erased, ix, count });
+		return vec_.erase(beg, last);
+	}
+
+	void pop_back()
+	{
+		erase(vec_.end() - 1);
+	}
+
+	///Assigns `value` to the element at `pos`.
+	void assign(const_iterator pos, const T &value)
+	{
+		//Saving the old value may move it out, so `value` must not be an element of the vector.
+		if (aliases(value))
+			return assign(pos, T(value));
+
+		auto it = begin_assign(pos, 1);
+		*it = value;
+	}
+
+	void assign(const_iterator pos, T &&value)
+	{
+		auto it = begin_assign(pos, 1);
+		*it = std::move(value);
+	}
+
+	///Assigns the elements of `first/last` over the elements starting at `pos`, which must all exist.
+	///`first/last` must not overlap the elements being assigned.
+	template<typename ForwardIt, typename = std::enable_if_t<std::is_base_of<std::forward_iterator_tag,
+		typename std::iterator_traits<ForwardIt>::iterator_category>::value>>
+	void assign(const_iterator pos, ForwardIt first, ForwardIt last)
+	{
+		auto count = size_type(std::distance(first, last));
+		if (count == 0)
+			return;
+
+		std::copy(first, last, begin_assign(pos, count));
+	}
+
+	void resize(size_type new_size)
+	{
+		resize_with(new_size, [&] { vec_.resize(new_size); });
+	}
+
+	void resize(size_type new_size, const T &value)
+	{
+		resize_with(new_size, [&] { vec_.resize(new_size, value); });
+	}
+
+	void clear()
+	{
+		erase(vec_.begin(), vec_.end());
+	}
+
+private:
+	vector_type &vec_;
+	my_vector<detail::undo_record> records_;
+	my_vector<T> saved_;
+
+	//Saved elements are moved out and back when that cannot throw part-way through.
+	using move_saved = std::integral_constant<bool,
+		std::is_nothrow_move_constructible<T>::value && std::is_nothrow_move_assignable<T>::value>;
+
+	bool aliases(const T &value) const noexcept
+	{
+		auto ptr = std::addressof(value);
+		return !std::less<const T*>{}(ptr, vec_.data()) && std::less<const T*>{}(ptr, vec_.data() + vec_.size());
+	}
+
+	//Makes room for one more record, so that logging an edit after making it cannot fail.
+	void reserve_record()
+	{
+		if (records_.size() == records_.capacity())
+			records_.reserve(records_.capacity() * 2 + 8);
+	}
+
+	void save(const_iterator first, const_iterator last)
+	{
+		save(const_cast<iterator>(first), const_cast<iterator>(last), move_saved{});
+	}
+
+	void save(iterator first, iterator last, std::true_type)
+	{
+		saved_.insert(saved_.end(), std::make_move_iterator(first), std::make_move_iterator(last));
+	}
+
+	void save(iterator first, iterator last, std::false_type)
+	{
+		saved_.insert(saved_.end(), first, last);
+	}
+
+	static std::move_iterator<iterator> restore_iterator(iterator it, std::true_type) { return std::make_move_iterator(it); }
+	static iterator restore_iterator(iterator it, std::false_type) { return it; }
+	static auto restore_iterator(iterator it) { return restore_iterator(it, move_saved{}); }
+
+	//Logs an insertion of `count` elements at `pos` once `func` has made it.
+	//An insertion that directly follows the last one extends its record, so a run of `push_back`s takes one.
+	template<typename Func>
+	iterator logged_insert(const_iterator pos, size_type count, Func func)
+	{
+		auto ix = size_type(pos - vec_.cbegin());
+		reserve_record();
+		auto result = func();
+		if (count == 0)
+			return result;
+
+		if (!records_.empty())
+		{
+			auto &prev = records_.back();
+			if (prev.kind == detail::undo_kind::inserted && prev.pos + prev.count == ix)
+			{
+				prev.count += count;
+				return result;
+			}
+		}
+
+		records_.push_back({ detail::undo_kind::inserted, ix, count });
+		return result;
+	}
+
+	//Saves the `count` elements at `pos` and logs their assignment. Returns a mutable iterator to `pos`.
+	iterator begin_assign(const_iterator pos, size_type count)
+	{
+		auto ix = size_type(pos - vec_.cbegin());
+		reserve_record();
+		save(pos, pos + count);
+		records_.push_back({ detail::undo_kind::assigned, ix, count });
+		return vec_.begin() + ix;
+	}
+
+	//Growing is logged as an insertion at the end; shrinking as erasing the tail.
+	template<typename Func>
+	void resize_with(size_type new_size, Func func)
+	{
+		auto old_size = vec_.size();
+		if (new_size < old_size)
+			erase(vec_.begin() + new_size, vec_.end());
+		else if (new_size > old_size)
+			logged_insert(vec_.end(), new_size - old_size, [&] { func(); return vec_.begin() + old_size; });
+	}
+};
+
+#endif //VECTOR_TRANSACTION_HEADER
@@ -1,5 +1,6 @@
 
 #include "vector_tools\my_vector.hpp"
+#include "vector_tools\columnar_table.hpp"
 #include <iostream>
 #include <string>
 
@@ -15,6 +16,16 @@ void print_vector(const my_vector<T, Alloc> &vec)
 	std::cout << std::endl;
 }
 
+//Prints a failure and returns false if `actual` is not `expected`.
+bool check_count(const char *what, std::size_t actual, std::size_t expected)
+{
+	if (actual == expected)
+		return true;
+
+	std::cout << "FAILED: " << what << " selected " << actual << " rows, expected " << expected << std::endl;
+	return false;
+}
+
 int main(int argc, const char*argv[])
 {
 	my_vector<int> ints({1, 2, 3, 4, 5, 20, 19, 18, 17, 16});
@@ -65,6 +76,21 @@ int main(int argc, const char*argv[])
 	print_vector(ints);
 
 
+	//Predicates compare in the column's type, not the constant's.
+	columnar_table<double, long long> table(
+		my_vector<double>{3.0, 3.7, 2.5, 4.0},
+		my_vector<long long>{1, (1LL << 32) + 1, -3, 5});
+	bool filters_ok = true;
+	filters_ok &= check_count("eq(3) on double", table.filter<0>(column_pred::eq(3)).count(), 1);
+	filters_ok &= check_count("between(3, 4) on double", table.filter<0>(column_pred::between(3, 4)).count(), 3);
+	filters_ok &= check_count("in({3, 4}) on double", table.filter<0>(column_pred::in(my_vector<int>{3, 4})).count(), 2);
+	filters_ok &= check_count("lt(5) on long long", table.filter<1>(column_pred::lt(5)).count(), 2);
+	filters_ok &= check_count("ge(5) on long long", table.filter<1>(column_pred::ge(5)).count(), 2);
+	if (!filters_ok)
+		return 1;
+
+	std::cout << "Mixed-type filters: ok" << std::endl;
+
 	std::cout << "Press keys.\n";
 
 	std::string str;